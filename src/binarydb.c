@@ -89,7 +89,11 @@ static Int allocated_blocks = 0;
 static char c_clean_file[255];
 
 static bool db_clean;
-static cStr *pad_string;
+
+/* Objects are packed into this buffer, which is kept between writes so
+ * that once it has grown to fit, writing an object allocates nothing.
+ * It is only used with the database locked. */
+static cBuf *pack_arena = NULL;
 
 extern Long db_top;
 extern Long num_objects;
@@ -237,7 +241,6 @@ void init_binary_db(void) {
     pthread_mutex_init (&db_mutex, NULL);
 #endif
 
-    pad_string = string_of_char(0, 256);
     sprintf(c_clean_file, "%s/.clean", c_dir_binary);
     DBFILE(fdb_objects, "objects");
     DBFILE(fdb_index,   "index");
@@ -285,7 +288,6 @@ void init_new_db(void) {
 #endif
     LOCK_DB("init_new_db")
 
-    pad_string = string_of_char(0, 256);
     sprintf(c_clean_file, "%s/.clean", c_dir_binary);
     DBFILE(fdb_objects, "objects");
     DBFILE(fdb_index,   "index");
@@ -598,6 +600,30 @@ static Int simble_alloc(Int size)
     }
 }
 
+/* Read the first len bytes of the object stored at offset. */
+static cBuf *simble_read(off_t offset, Int len)
+{
+    cBuf *buf;
+    Long  nread;
+
+    LOCK_DB("simble_read")
+
+    /* seek to location */
+    if (lseek(database_fd, offset, SEEK_SET) == -1) {
+        UNLOCK_DB("simble_read")
+        return NULL;
+    }
+
+    buf = buffer_new(len);
+    buf->len = len;
+    nread = read(database_fd, buf->s, len);
+    UNLOCK_DB("simble_read")
+    if (nread != len)
+        panic("simble_read: only read %d of %d bytes.", nread, len);
+
+    return buf;
+}
+
 bool simble_get(Obj *object, cObjnum objnum, Long *sizeread)
 {
     off_t offset;
@@ -612,22 +638,10 @@ bool simble_get(Obj *object, cObjnum objnum, Long *sizeread)
     if (!lookup_retrieve_objnum(objnum, &offset, &size))
         return false;
 
-    LOCK_DB("simble_get")
-
-    /* seek to location */
-    if (lseek(database_fd, offset, SEEK_SET) == -1) {
-        UNLOCK_DB("simble_get")
+    if (!(buf = simble_read(offset, size)))
         return false;
-    }
-
     if (sizeread)
         *sizeread = size;
-    buf = buffer_new(size);
-    buf->len = size;
-    buf_pos = read(database_fd, buf->s, size);
-    UNLOCK_DB("simble_get")
-    if (buf_pos != size)
-        panic("simble_get: only read %d of %d bytes.", buf_pos, size);
 
     buf_pos = 0;
     unpack_object(buf, &buf_pos, object);
@@ -636,6 +650,36 @@ bool simble_get(Obj *object, cObjnum objnum, Long *sizeread)
     return true;
 }
 
+/* Read just the name and parents of an object.  These come first, so a
+ * single block is nearly always enough; objects with very long parent
+ * lists, and those written before objects were sectioned, are read whole. */
+bool simble_get_parents(Obj *object, cObjnum objnum)
+{
+    off_t offset;
+    Int size;
+    cBuf *buf;
+    Long start, end;
+
+    if (!lookup_retrieve_objnum(objnum, &offset, &size))
+        return false;
+
+    if (!(buf = simble_read(offset, size < BLOCK_SIZE ? size : BLOCK_SIZE)))
+        return false;
+
+    if (buf->len < size &&
+        (!unpack_section_range(buf, SECTION_PARENTS, &start, &end) ||
+         end > buf->len)) {
+        buffer_discard(buf);
+        if (!(buf = simble_read(offset, size)))
+            return false;
+    }
+
+    unpack_object_parents(buf, object);
+    buffer_discard(buf);
+
+    return true;
+}
+
 static bool check_free_blocks(Int blocks_needed, Int b)
 {
     Int count;
@@ -652,21 +696,44 @@ static bool check_free_blocks(Int blocks_needed, Int b)
     return count == blocks_needed;
 }
 
+/* Pack obj into pack_arena, padded with zeros to a whole number of blocks.
+ * size_object() gives the packed size exactly, so the arena is grown at
+ * most once, before packing begins. */
+static cBuf *simble_pack(const Obj *obj)
+{
+    Int size;
+
+    /* write_long() wants room for a whole Long past what it writes. */
+    size = BLOCK_OFFSET(NEEDED(size_object((Obj *) obj, false), BLOCK_SIZE));
+    size += sizeof(Long) + 1;
+    if (!pack_arena)
+        pack_arena = buffer_new(size);
+    else
+        pack_arena = buffer_prep(pack_arena, size);
+
+    pack_arena->len = 0;
+    pack_arena = pack_object(pack_arena, obj);
+
+    size = BLOCK_OFFSET(NEEDED(pack_arena->len, BLOCK_SIZE));
+    pack_arena = buffer_prep(pack_arena, size);
+    memset(&pack_arena->s[pack_arena->len], 0, size - pack_arena->len);
+    pack_arena->len = size;
+
+    return pack_arena;
+}
+
 bool simble_put(const Obj *obj, cObjnum objnum, Long *sizewritten)
 {
     cBuf *buf;
     off_t old_offset, new_offset;
     Int old_size, new_size, tmp1, tmp2;
 
+    LOCK_DB("simble_put")
+    buf = simble_pack(obj);
+    new_size = buf->len;
+
     old_offset = -1;
     if (lookup_retrieve_objnum(objnum, &old_offset, &old_size)) {
-        buf = buffer_new(old_size);
-        buf = pack_object(buf, obj);
-        if (buf->len % BLOCK_SIZE)
-            buf = buffer_append_uchars_single_ref(buf, (unsigned char*)pad_string->s, 256 - (buf->len % BLOCK_SIZE));
-        new_size = buf->len;
-
-        LOCK_DB("simble_put")
         simble_flag_as_dirty();
 
         if ((tmp1=NEEDED(new_size, BLOCK_SIZE)) > (tmp2=NEEDED(old_size, BLOCK_SIZE))) {
@@ -693,13 +760,6 @@ bool simble_put(const Obj *obj, cObjnum objnum, Long *sizewritten)
         }
     } else {
         ++num_objects;
-        buf = buffer_new(0);
-        buf = pack_object(buf, obj);
-        if (buf->len % BLOCK_SIZE)
-            buf = buffer_append_uchars_single_ref(buf, (unsigned char*)pad_string->s, 256 - (buf->len % BLOCK_SIZE));
-        new_size = buf->len;
-
-        LOCK_DB("simble_put")
         simble_flag_as_dirty();
 
         new_offset = BLOCK_OFFSET((off_t)simble_alloc(new_size));
@@ -710,25 +770,21 @@ bool simble_put(const Obj *obj, cObjnum objnum, Long *sizewritten)
       (new_size   != old_size)) {
         if (!lookup_store_objnum(objnum, new_offset, new_size)) {
             UNLOCK_DB("simble_put")
-            buffer_discard(buf);
             if (sizewritten) *sizewritten = 0;
             return false;
         }
     }
 
-    if (lseek(database_fd, new_offset, SEEK_SET) == -1) {
-        UNLOCK_DB("simble_put")
-        buffer_discard(buf);
-        write_err("ERROR: simble_put: seek failed: offset=%l obj=#%l %s", new_offset, objnum, strerror(errno));
-        if (sizewritten) *sizewritten = 0;
-        return false;
-    }
-
-    old_size = write(database_fd, buf->s, new_size);
-    buffer_discard(buf);
+    old_size = pwrite(database_fd, buf->s, new_size, new_offset);
     UNLOCK_DB("simble_put")
-    if (old_size != new_size)
+    if (old_size != new_size) {
+        if (old_size == -1) {
+            write_err("ERROR: simble_put: write failed: offset=%l obj=#%l %s", new_offset, objnum, strerror(errno));
+            if (sizewritten) *sizewritten = 0;
+            return false;
+        }
         panic("simble_put: only wrote %d of %d bytes.", old_size, new_size);
+    }
 
     if (sizewritten) *sizewritten = new_size;
 
@@ -795,7 +851,10 @@ void simble_close(void)
     close(database_fd);
     efree(bitmap);
     simble_flag_as_clean();
-    string_discard(pad_string);
+    if (pack_arena) {
+        buffer_discard(pack_arena);
+        pack_arena = NULL;
+    }
     UNLOCK_DB("simble_close")
 }
 
@@ -237,6 +237,7 @@ void init_cache(bool spawn_cleaner)
             obj->ucounter=0;
 #endif
             obj->dead=0;
+            obj->partial=0;
 
             cache_add_to_list_head(&inactive[i], obj);
         }
@@ -337,6 +338,7 @@ Obj * cache_get_holder(cObjnum objnum) {
     obj->search = START_SEARCH_AT;
     obj->dirty = 0;
     obj->dead = 0;
+    obj->partial = 0;
     obj->refs = 1;
 #ifdef CLEAN_CACHE
     obj->ucounter = OBJECT_PERSISTENCE;
@@ -345,6 +347,8 @@ Obj * cache_get_holder(cObjnum objnum) {
     /* we may actually have a connection or file, and when
        it is used these will get set correctly */
     obj->extras = NULL;
+    obj->vtable = NULL;
+    obj->vars_version = ++vars_versions;
 
 #if DEBUG_CACHE
     _acounter++;
@@ -356,21 +360,40 @@ Obj * cache_get_holder(cObjnum objnum) {
     return obj;
 }
 
-/*
-// ----------------------------------------------------------------------
-//
-// Requires: Initialized cache.
-// Modifies: Contents of active, inactive, database files
-// Effects: Returns the object associated with objnum, getting it from the cache
-//            or from disk.  If the object is in the inactive chain or is on
-//            disk, it will be linked into the active chain.  Returns NULL if no
-//            object exists with the given objnum.
-//
-*/
-Obj *cache_retrieve(cObjnum objnum) {
+/* Finish reading an object of which only the parents were read.  The
+// parents list we already have is kept, since callers of
+// cache_retrieve_parents() may still be looking at it. */
+static void cache_complete_object(Obj *obj)
+{
+    cList *parents = obj->parents;
+    Ident objname = obj->objname;
+    Long obj_size;
+
+    LOCK_BUCKET("cache_complete_object", obj->objnum % cache_width)
+    if (!simble_get(obj, obj->objnum, &obj_size)) {
+        UNLOCK_BUCKET("cache_complete_object", obj->objnum % cache_width)
+        panic("Could not read object #%l.", obj->objnum);
+    }
+    UNLOCK_BUCKET("cache_complete_object", obj->objnum % cache_width)
+    list_discard(obj->parents);
+    obj->parents = parents;
+    if (objname != NOT_AN_IDENT)
+        ident_discard(objname);
+    obj->partial = 0;
+
+    if (cache_log_flag & CACHE_LOG_READ)
+        write_err("cache_retrieve: completed object %s (size: %d bytes)",
+                  obj->objname != -1 ? ident_name(obj->objname) : "not named", obj_size);
+#ifdef USE_PARENT_OBJS
+    object_load_parent_objs(obj);
+#endif
+}
+
+static Obj *cache_find(cObjnum objnum, bool parents_only) {
     Int ind = objnum % cache_width;
     Obj *obj;
     Long obj_size;
+    bool found;
 
     if (objnum < 0)
         return NULL;
@@ -382,6 +405,8 @@ Obj *cache_retrieve(cObjnum objnum) {
 #ifdef CLEAN_CACHE
             obj->ucounter += OBJECT_PERSISTENCE;
 #endif
+            if (obj->partial && !parents_only)
+                cache_complete_object(obj);
             return obj;
         }
     }
@@ -404,6 +429,8 @@ Obj *cache_retrieve(cObjnum objnum) {
 #if DEBUG_CACHE
             _acounter++;
 #endif
+            if (obj->partial && !parents_only)
+                cache_complete_object(obj);
             return obj;
         }
     }
@@ -413,7 +440,13 @@ Obj *cache_retrieve(cObjnum objnum) {
 
     /* Read the object into the place-holder, if it's on disk. */
     LOCK_BUCKET("cache_retrieve", ind)
-    if (!simble_get(obj, objnum, &obj_size)) {
+    if (parents_only) {
+        obj_size = -1;
+        found = simble_get_parents(obj, objnum);
+    } else {
+        found = simble_get(obj, objnum, &obj_size);
+    }
+    if (!found) {
         /* Oops.  add back to inactive list tail*/
         obj->objnum = INV_OBJNUM;
         cache_remove_from_list(&active[ind], obj);
@@ -421,16 +454,55 @@ Obj *cache_retrieve(cObjnum objnum) {
         obj = NULL;
     }
     UNLOCK_BUCKET("cache_retrieve", ind)
-    if (obj && cache_log_flag & CACHE_LOG_READ)
+    if (!obj)
+        return NULL;
+    if (parents_only) {
+        obj->partial = 1;
+#ifdef USE_PARENT_OBJS
+        obj->parent_objs = NULL;
+#endif
+        return obj;
+    }
+    if (cache_log_flag & CACHE_LOG_READ)
         write_err("cache_retrieve: read object %s (size: %d bytes)",
                   obj->objname != -1 ? ident_name(obj->objname) : "not named", obj_size);
 #ifdef USE_PARENT_OBJS
-    if (obj)
-        object_load_parent_objs(obj);
+    object_load_parent_objs(obj);
 #endif
     return obj;
 }
 
+/*
+// ----------------------------------------------------------------------
+//
+// Requires: Initialized cache.
+// Modifies: Contents of active, inactive, database files
+// Effects: Returns the object associated with objnum, getting it from the cache
+//            or from disk.  If the object is in the inactive chain or is on
+//            disk, it will be linked into the active chain.  Returns NULL if no
+//            object exists with the given objnum.
+//
+*/
+Obj *cache_retrieve(cObjnum objnum) {
+    return cache_find(objnum, false);
+}
+
+/*
+// ----------------------------------------------------------------------
+//
+// Requires: Initialized cache.
+// Modifies: Contents of active, inactive, database files
+// Effects: As cache_retrieve(), except that only the name and parents of the
+//            object are guaranteed to be loaded.  If the object has to come
+//            from disk only those are read, and the object is completed by
+//            the next cache_retrieve() of it.  The object must not be
+//            modified or dirtied through this reference.
+//
+*/
+Obj *cache_retrieve_parents(cObjnum objnum) {
+    return cache_find(objnum, true);
+}
+
 /*
 // ----------------------------------------------------------------------
 */
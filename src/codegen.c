@@ -1828,9 +1828,14 @@ static Method *final_pass(Obj *object)
     Int i, j, opcode, arg_type, cur_error_list;
 
     method = EMALLOC(Method, 1);
+    method->object   = object;
     method->m_flags  = MF_NONE;
     method->m_access = MS_PUBLIC;
     method->native   = -1;
+    method->packed   = NULL;
+    method->threaded = NULL;
+    method->lines    = NULL;
+    method->source_hash = 0;
 
     /* Set argument names. */
     method->num_args = id_list_size(the_prog->args->ids);
@@ -1932,6 +1937,7 @@ static Method *final_pass(Obj *object)
     }
 
     method->refs = 1;
+    method->call_refs = 0;
     return method;
 }
 
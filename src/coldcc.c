@@ -44,6 +44,9 @@ static void   compile_db(Int type);
 
 void shutdown_coldcc(int exit_status) {
     running = false;
+#ifdef PROFILE_EXECUTE
+    dump_execute_profile();
+#endif
     write_err("Syncing binarydb...");
     cache_sync();
     simble_close();
@@ -125,6 +128,9 @@ static void compile_db(Int newdb) {
         fclose(fp);
     }
 
+    if (!newdb)
+        write_err("Methods: %l changed, %l added, %l unchanged.",
+                  methods_changed, methods_added, methods_unchanged);
     write_err ("Database compiled to \"%s\"", c_dir_binary);
 }
 
@@ -292,6 +298,16 @@ static void initialize(Int argc, char **argv) {
                     }
                     break;
                 }
+                case 'm':
+                    argv += getarg(name, &buf, opt, argv, &argc, usage);
+                    method_cache_size = atoi(buf);
+                    if (method_cache_size <= 0 ||
+                        method_cache_size > METHOD_CACHE_MAX) {
+                        usage(name);
+                        printf("\n** Invalid method cache size: '%s'\n", buf);
+                        exit(0);
+                    }
+                    break;
                 case 'W':
                     print_warn = false;
                     break;
@@ -356,16 +372,18 @@ void usage (const char * name) {
              "                    If this is \"stdin\" it will read from stdin\n"
              "                    instead.  <target> may be a directory or file.\n"
              "    -p              Partial compile, compile object(s) and insert\n"
-             "                    into database accordingly.\n"
+             "                    into database accordingly.  Methods whose\n"
+             "                    text is unchanged are not compiled again.\n"
              "    +|-#            Print/Do not print object numbers by default.\n"
              "                    Default option is +#\n"
              "                    print object names by default, if they exist.\n"
              "    -s WIDTHxDEPTH  Cache size, default %dx%d\n"
+             "    -m SIZE         Method cache entries, default %d, at most %d\n"
              "    -n              List native method configuration.\n"
              "    +|-o            Print/Do not print objects as they are processed.\n"
              "    -W              Do not print warnings.\n"
              "\n\n",
              VERSION_MAJOR, VERSION_MINOR, VERSION_PATCH, name, c_dir_binary, c_dir_textdump,
-             CACHE_WIDTH, CACHE_DEPTH);
+             CACHE_WIDTH, CACHE_DEPTH, METHOD_CACHE_SIZE, METHOD_CACHE_MAX);
     fflush(stderr);
 }
@@ -20,6 +20,7 @@ cBuf *buffer_new(Int size_needed) {
     buf->len = 0;
     buf->size = size_needed - BUFFER_OVERHEAD;
     buf->refs = 1;
+    buf->hash = 0;
     return buf;
 }
 
@@ -55,6 +56,7 @@ cBuf * buffer_append_uchars_single_ref(cBuf * buf, const unsigned char * new, In
 
     memcpy(buf->s + buf->len, new, new_len);
     buf->len += new_len;
+    buf->hash = 0;
     return buf;
 }
 
@@ -67,6 +69,15 @@ cBuf * buffer_append_uchars(cBuf * buf1, const unsigned char * new, Int new_len)
     return buf1;
 }
 
+uLong buffer_hash(cBuf *buf) {
+    if (!buf->hash) {
+        buf->hash = hash_chars((const char *) buf->s, buf->len, false);
+        if (!buf->hash)
+            buf->hash = 1;
+    }
+    return buf->hash;
+}
+
 Int buffer_retrieve(const cBuf *buf, Int pos) {
     return buf->s[pos];
 }
@@ -321,8 +332,10 @@ cBuf *buffer_prep(cBuf *buf, Int new_size) {
         new_size = ROUND_UP(new_size + BUFFER_OVERHEAD, BUFFER_DATA_INCREMENT);
         buf = (cBuf*)erealloc(buf, new_size);
         buf->size = new_size - BUFFER_OVERHEAD;
+        buf->hash = 0;
         return buf;
     } else {
+        buf->hash = 0;
         return buf;
     }
 }
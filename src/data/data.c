@@ -12,9 +12,11 @@
 #include "macros.h"
 
 INSTANCE_PROTOTYPES(handled);
+INSTANCE_PROTOTYPES(sorted);
 
 cInstance class_registry[] = {
-     INSTANCE_INIT(handled, "a frob")
+     INSTANCE_INIT(handled, "a frob"),
+     INSTANCE_INIT(sorted, "a sorted list")
 };
 
 void register_instance (InstanceID instance, Ident id) {
@@ -23,6 +25,7 @@ void register_instance (InstanceID instance, Ident id) {
 
 void init_instances(void) {
     register_instance (HANDLED_FROB_TYPE, frob_id);
+    register_instance (SORTED_TYPE, sorted_id);
 }
 
 /* ack, hacky */
@@ -138,7 +141,7 @@ Int data_true(const cData *d)
         return 1;
 
       case DICT:
-        return (d->u.dict->keys->len != 0);
+        return (dict_size(d->u.dict) != 0);
 
       case BUFFER:
         return (d->u.buffer->len != 0);
@@ -149,14 +152,14 @@ Int data_true(const cData *d)
 #endif
 
       default:
+        if (d->type == SORTED_TYPE)
+            return (sorted_length(SORTED(d)) != 0);
         return 1;
     }
 }
 
 uLong data_hash(const cData *d)
 {
-    cList *values;
-
     switch (d->type) {
 
       case INTEGER:
@@ -169,16 +172,13 @@ uLong data_hash(const cData *d)
       }
 
       case STRING:
-        return hash_string_nocase(d->u.str);
+        return string_hash(d->u.str);
 
       case OBJNUM:
         return d->u.objnum;
 
       case LIST:
-        if (list_length(d->u.list) > 0)
-            return data_hash(list_first(d->u.list));
-        else
-            return 100;
+        return list_hash(d->u.list);
 
       case SYMBOL:
         return ident_hash(d->u.symbol);
@@ -187,20 +187,15 @@ uLong data_hash(const cData *d)
         return hash_nullchar(ident_name(d->u.error));
 
       case FROB:
-        return d->u.frob->cclass + data_hash(&d->u.frob->rep);
+        return hash_combine(d->u.frob->cclass, data_hash(&d->u.frob->rep));
 
       case DICT:
-        values = d->u.dict->values;
-        if (list_length(values) > 0)
-            return data_hash(list_first(values));
-        else
-            return 200;
+        dict_compact(d->u.dict);
+        return hash_combine(list_hash(d->u.dict->keys),
+                            list_hash(d->u.dict->values));
 
       case BUFFER:
-        if (d->u.buffer->len)
-            return d->u.buffer->s[0] + d->u.buffer->s[d->u.buffer->len - 1];
-        else
-            return 300;
+        return buffer_hash(d->u.buffer);
 
 #ifdef USE_PARENT_OBJS
       case OBJECT:
@@ -714,6 +709,65 @@ dict_error:
 #ifndef ONLY_PARSE_TEXTDB
         list_discard(keys);
         list_discard(values);
+#endif
+        return s;
+    } else if (*s == '#' && s[1] == '{') {
+        cData key, elem;
+        bool keyed = false, first = true;
+#ifndef ONLY_PARSE_TEXTDB
+        cList *elems;
+        cData *p;
+
+        elems = list_new(10);
+#endif
+
+        /* #{elem, ...}, or #{key; elem, ...} if the elements are keyed */
+        s += 2;
+        while (isspace(*s))
+            s++;
+        while (*s && *s != '}') {
+            s = data_from_literal(&elem, s);
+            if (elem.type == -1)
+                goto sorted_error;
+            while (isspace(*s))
+                s++;
+            if (*s == ';' && first) {
+                key = elem;
+                keyed = true;
+                s++;
+            } else {
+#ifndef ONLY_PARSE_TEXTDB
+                elems = list_add(elems, &elem);
+                data_discard(&elem);
+#endif
+                if (*s == ',')
+                    s++;
+            }
+            first = false;
+            while (isspace(*s))
+                s++;
+        }
+        d->type = SORTED_TYPE;
+#ifndef ONLY_PARSE_TEXTDB
+        for (p = list_first(elems); p; p = list_next(elems, p)) {
+            if (!sorted_valid_elem(keyed ? &key : NULL, p)) {
+                d->type = -1;
+                break;
+            }
+        }
+        if (d->type != -1)
+            d->u.instance = sorted_from_list(elems, keyed ? &key : NULL);
+        list_discard(elems);
+        if (keyed)
+            data_discard(&key);
+#endif
+        return (*s) ? s + 1 : s;
+sorted_error:
+        d->type = -1;
+#ifndef ONLY_PARSE_TEXTDB
+        list_discard(elems);
+        if (keyed)
+            data_discard(&key);
 #endif
         return s;
     } else if (*s == '#') {
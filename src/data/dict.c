@@ -6,19 +6,44 @@
 
 #include "dict.h"
 
-#define MALLOC_DELTA                         0
+/*
+// The keys and values lists hold a dictionary's entries in the order they
+// were added, and the hash table finds them.  The table is open addressed
+// with Robin Hood probing: a key being inserted takes the slot of any key
+// nearer its home slot than the new key is to its own, so that no key lies
+// far from home and a search can stop at the first key nearer its home than
+// the one sought would be.  Deleting a key shifts the keys after it back a
+// slot, so there are no tombstones in the table.
+//
+// Deleting an entry other than the last leaves a hole in the lists, an
+// integer 0 which no slot refers to.  Holes are squeezed out by
+// dict_compact() once they outnumber the entries, and before anything which
+// looks at the lists by position.
+*/
+
 #define HASHTAB_STARTING_SIZE                 8
 
-static void insert_key(cDict *dict, Int i);
-static Int search(const cDict *dict, cData *key);
+#define HASHTAB_MASK(dict)         ((dict)->hashtab_size - 1)
+#define HASHTAB_FULL(dict, n)      ((n) * 4 > (dict)->hashtab_size * 3)
+#define DISTANCE(dict, pos, hash) \
+    ((Int) (((uLong) (pos) - (hash)) & HASHTAB_MASK(dict)))
+
+static uLong hash_key(cData *key);
+static void alloc_hashtab(cDict *dict, Int size);
+static void insert_key(cDict *dict, Int i, uLong hash);
+static void remove_slot(cDict *dict, Int pos);
+static Int search(const cDict *dict, cData *key, uLong hash);
 static void increase_hashtab_size(cDict *dict);
+static cDict *add_entry(cDict *dict, cData *key, cData *value, uLong hash);
+static void make_hole(cDict *dict, Int i);
 
 static cDict *generic_empty_dict;
 
 cDict *dict_new(cList *keys, cList *values)
 {
     cDict *cnew;
-    Int i, j, size;
+    Int i, size;
+    uLong hash;
 
     if (generic_empty_dict && list_length(keys) == 0)
         return dict_dup(generic_empty_dict);
@@ -28,39 +53,23 @@ cDict *dict_new(cList *keys, cList *values)
 
     cnew->keys   = list_dup(keys);
     cnew->values = list_dup(values);
-
-    /* Calculate initial size of chain and hash table. */
-    cnew->hashtab_size = HASHTAB_STARTING_SIZE;
-    while (cnew->hashtab_size < keys->len) {
-        if (cnew->hashtab_size > 4096)
-            cnew->hashtab_size += 4096;
+    cnew->holes  = 0;
+
+    /* Calculate the initial size of the hash table. */
+    size = HASHTAB_STARTING_SIZE;
+    while (list_length(keys) * 4 > size * 3)
+        size *= 2;
+    alloc_hashtab(cnew, size);
+
+    /* Insert the keys into the hash table, making holes of duplicates. */
+    for (i = 0; i < list_length(keys); i++) {
+        hash = hash_key(list_elem(keys, i));
+        if (search(cnew, list_elem(keys, i), hash) == F_FAILURE)
+            insert_key(cnew, i, hash);
         else
-            cnew->hashtab_size = cnew->hashtab_size * 2 + MALLOC_DELTA;
-    }
-
-    /* Initialize chain entries and hash table. */
-    size = sizeof(Int) * cnew->hashtab_size;
-    cnew->links   = tmalloc(size);
-    cnew->hashtab = tmalloc(size);
-    memset(cnew->links,   -1, size);
-    memset(cnew->hashtab, -1, size);
-
-    /* Insert the keys into the hash table, eliminating duplicates. */
-    i = j = 0;
-    while (i < cnew->keys->len) {
-        if (i != j) {
-            cnew->keys->el[j] = cnew->keys->el[i];
-            cnew->values->el[j] = cnew->values->el[i];
-        }
-        if (search(cnew, &keys->el[i]) == F_FAILURE) {
-            insert_key(cnew, j++);
-        } else {
-            data_discard(&cnew->keys->el[i]);
-            data_discard(&cnew->values->el[i]);
-        }
-        i++;
+            make_hole(cnew, i);
     }
-    cnew->keys->len = cnew->values->len = j;
+    dict_compact(cnew);
 
     cnew->refs = 1;
 
@@ -125,14 +134,15 @@ void dict_discard(cDict *dict)
     if (!dict->refs) {
         list_discard(dict->keys);
         list_discard(dict->values);
-        tfree(dict->links, sizeof(Int) * dict->hashtab_size);
-        tfree(dict->hashtab, sizeof(Int) * dict->hashtab_size);
+        tfree(dict->hashtab, sizeof(struct dict_slot) * dict->hashtab_size);
         tfree(dict, sizeof(cDict));
     }
 }
 
 Int dict_cmp(cDict *dict1, cDict *dict2)
 {
+    dict_compact(dict1);
+    dict_compact(dict2);
     if (list_cmp(dict1->keys, dict2->keys) == 0 &&
         list_cmp(dict1->values, dict2->values) == 0)
         return 0;
@@ -143,70 +153,43 @@ Int dict_cmp(cDict *dict1, cDict *dict2)
 cDict *dict_add(cDict *dict, cData *key, cData *value)
 {
     Int pos;
+    uLong hash;
 
     dict = dict_prep(dict);
 
     /* Just replace the value for the key if it already exists. */
-    pos = search(dict, key);
+    hash = hash_key(key);
+    pos = search(dict, key, hash);
     if (pos != F_FAILURE) {
-        dict->values = list_replace(dict->values, pos, value);
+        dict->values = list_replace(dict->values, dict->hashtab[pos].index,
+                                    value);
         return dict;
     }
 
-    /* Add the key and value to the list. */
-    dict->keys = list_add(dict->keys, key);
-    dict->values = list_add(dict->values, value);
-
-    /* Check if we should resize the hash table. */
-    if (dict->keys->len > dict->hashtab_size)
-        increase_hashtab_size(dict);
-    else
-        insert_key(dict, dict->keys->len - 1);
-    return dict;
+    return add_entry(dict, key, value, hash);
 }
 
 /* Error-checking is the caller's responsibility; this routine assumes that it
  * will find the key in the dictionary. */
 cDict *dict_del(cDict *dict, cData *key)
 {
-    Int ind, *ip, i = -1, j;
+    Int pos, i;
 
     dict = dict_prep(dict);
 
-    /* Search for a pointer to the key, either in the hash table entry or in
-     * the chain links. */
-    ind = data_hash(key) % dict->hashtab_size;
-    for (ip = &dict->hashtab[ind];; ip = &dict->links[*ip]) {
-        i = *ip;
-        if (data_cmp(&dict->keys->el[i], key) == 0)
-            break;
-    }
+    pos = search(dict, key, hash_key(key));
+    i = dict->hashtab[pos].index;
+    remove_slot(dict, pos);
 
-    /* Delete the element from the keys and values lists. */
-    dict->keys = list_delete(dict->keys, i);
-    dict->values = list_delete(dict->values, i);
-
-    /* Replace the pointer to the key index with the next link. */
-    *ip = dict->links[i];
-
-    /* Copy the links beyond i backward. */
-    MEMMOVE(dict->links + i, dict->links + i + 1, dict->keys->len - i);
-    dict->links[dict->keys->len] = -1;
-
-    /* Since we've renumbered all the elements beyond i, we have to check
-     * all the links and hash table entries.  If they're greater than i,
-     * decrement them.  Skip this step if the element we removed was the last
-     * one. */
-    if (i < dict->keys->len) {
-        for (j = 0; j < dict->keys->len; j++) {
-            if (dict->links[j] > i)
-                dict->links[j]--;
-        }
-        for (j = 0; j < dict->hashtab_size; j++) {
-            if (dict->hashtab[j] > i)
-                dict->hashtab[j]--;
-        }
+    /* The last entry can simply be dropped; any other leaves a hole. */
+    if (i == list_length(dict->keys) - 1) {
+        dict->keys = list_delete(dict->keys, i);
+        dict->values = list_delete(dict->values, i);
+    } else {
+        make_hole(dict, i);
     }
+    if (dict->holes > dict_size(dict))
+        dict_compact(dict);
 
     return dict;
 }
@@ -215,11 +198,11 @@ bool dict_find(const cDict *dict, cData *key, cData *ret)
 {
     Int pos;
 
-    pos = search(dict, key);
+    pos = search(dict, key, hash_key(key));
     if (pos == F_FAILURE)
         return false;
 
-    data_dup(ret, &dict->values->el[pos]);
+    data_dup(ret, list_elem(dict->values, dict->hashtab[pos].index));
     return true;
 }
 
@@ -227,17 +210,19 @@ bool dict_contains(const cDict *dict, cData *key)
 {
     Int pos;
 
-    pos = search(dict, key);
+    pos = search(dict, key, hash_key(key));
     return (pos != F_FAILURE);
 }
 
 cList *dict_values(cDict *dict)
 {
+    dict_compact(dict);
     return list_dup(dict->values);
 }
 
 cList *dict_keys(cDict *dict)
 {
+    dict_compact(dict);
     return list_dup(dict->keys);
 }
 
@@ -245,12 +230,12 @@ cList *dict_key_value_pair(cDict *dict, Int i)
 {
     cList *l;
 
-    if (i >= dict->keys->len)
+    dict_compact(dict);
+    if (i >= list_length(dict->keys))
         return NULL;
     l = list_new(2);
-    l->len = 2;
-    data_dup(&l->el[0], &dict->keys->el[i]);
-    data_dup(&l->el[1], &dict->values->el[i]);
+    l = list_add(l, list_elem(dict->keys, i));
+    l = list_add(l, list_elem(dict->values, i));
     return l;
 }
 
@@ -258,14 +243,15 @@ cStr *dict_add_literal_to_str(cStr *str, cDict *dict, int flags)
 {
     Int i;
 
+    dict_compact(dict);
     str = string_add_chars(str, "#[", 2);
-    for (i = 0; i < dict->keys->len; i++) {
+    for (i = 0; i < list_length(dict->keys); i++) {
         str = string_addc(str, '[');
-        str = data_add_literal_to_str(str, &dict->keys->el[i], flags);
+        str = data_add_literal_to_str(str, list_elem(dict->keys, i), flags);
         str = string_add_chars(str, ", ", 2);
-        str = data_add_literal_to_str(str, &dict->values->el[i], flags);
+        str = data_add_literal_to_str(str, list_elem(dict->values, i), flags);
         str = string_addc(str, ']');
-        if (i < dict->keys->len - 1)
+        if (i < list_length(dict->keys) - 1)
             str = string_add_chars(str, ", ", 2);
     }
     return string_addc(str, ']');
@@ -281,66 +267,188 @@ cDict *dict_prep(cDict *dict) {
     cnew = tmalloc(sizeof(cDict));
     cnew->keys         = list_dup(dict->keys);
     cnew->values       = list_dup(dict->values);
+    cnew->holes        = dict->holes;
     cnew->hashtab_size = dict->hashtab_size;
-    cnew->links        = tmalloc(sizeof(Int) * cnew->hashtab_size);
-    cnew->hashtab      = tmalloc(sizeof(Int) * cnew->hashtab_size);
-    MEMCPY(cnew->links,   dict->links,   cnew->hashtab_size);
+    cnew->hashtab      = tmalloc(sizeof(struct dict_slot) * cnew->hashtab_size);
     MEMCPY(cnew->hashtab, dict->hashtab, cnew->hashtab_size);
     dict->refs--;
     cnew->refs = 1;
     return cnew;
 }
 
-static void insert_key(cDict *dict, Int i)
+/* Squeeze the holes out of the keys and values lists.  This leaves the
+ * entries as they were, so it may be done to a dictionary with other
+ * references. */
+void dict_compact(cDict *dict)
 {
-    Int ind;
+    cList *keys, *values;
+    Int *index, i, len = list_length(dict->keys);
+
+    if (!dict->holes)
+        return;
+
+    /* Find where each entry which is not a hole will go. */
+    index = tmalloc(sizeof(Int) * len);
+    for (i = 0; i < len; i++)
+        index[i] = -1;
+    for (i = 0; i < dict->hashtab_size; i++) {
+        if (dict->hashtab[i].index != -1)
+            index[dict->hashtab[i].index] = 0;
+    }
 
-    ind = data_hash(&dict->keys->el[i]) % dict->hashtab_size;
-    dict->links[i] = dict->hashtab[ind];
-    dict->hashtab[ind] = i;
+    keys = list_new(dict_size(dict));
+    values = list_new(dict_size(dict));
+    for (i = 0; i < len; i++) {
+        if (index[i] == -1)
+            continue;
+        index[i] = list_length(keys);
+        keys = list_add(keys, list_elem(dict->keys, i));
+        values = list_add(values, list_elem(dict->values, i));
+    }
+
+    for (i = 0; i < dict->hashtab_size; i++) {
+        if (dict->hashtab[i].index != -1)
+            dict->hashtab[i].index = index[dict->hashtab[i].index];
+    }
+
+    tfree(index, sizeof(Int) * len);
+    list_discard(dict->keys);
+    list_discard(dict->values);
+    dict->keys = keys;
+    dict->values = values;
+    dict->holes = 0;
 }
 
-static Int search(const cDict *dict, cData *key) {
-    Int ind, i;
+/* data_hash() of some types is weak in the low bits, which are all the
+ * table looks at, so mix the high bits down. */
+static uLong hash_key(cData *key)
+{
+    uLong hash = data_hash(key) * 2654435769UL;
+
+    return hash ^ (hash >> 16);
+}
 
-    ind = data_hash(key) % dict->hashtab_size;
-    for (i = dict->hashtab[ind]; i != -1; i = dict->links[i]) {
-        if (data_cmp(&dict->keys->el[i], key) == 0)
-            return i;
+static void alloc_hashtab(cDict *dict, Int size)
+{
+    Int i;
+
+    dict->hashtab_size = size;
+    dict->hashtab = tmalloc(sizeof(struct dict_slot) * size);
+    for (i = 0; i < size; i++)
+        dict->hashtab[i].index = -1;
+}
+
+static void insert_key(cDict *dict, Int i, uLong hash)
+{
+    struct dict_slot *slot, tmp;
+    Int pos, dist, slot_dist;
+
+    pos = hash & HASHTAB_MASK(dict);
+    for (dist = 0;; pos = (pos + 1) & HASHTAB_MASK(dict), dist++) {
+        slot = &dict->hashtab[pos];
+        if (slot->index == -1) {
+            slot->index = i;
+            slot->hash = hash;
+            return;
+        }
+
+        /* Take the place of a key nearer its home, and carry it on. */
+        slot_dist = DISTANCE(dict, pos, slot->hash);
+        if (slot_dist < dist) {
+            tmp = *slot;
+            slot->index = i;
+            slot->hash = hash;
+            i = tmp.index;
+            hash = tmp.hash;
+            dist = slot_dist;
+        }
     }
+}
 
-    return F_FAILURE;
+static void remove_slot(cDict *dict, Int pos)
+{
+    Int next;
+
+    /* Shift back the keys after pos, up to an empty slot or a key which is
+     * already home. */
+    for (;;) {
+        next = (pos + 1) & HASHTAB_MASK(dict);
+        if (dict->hashtab[next].index == -1 ||
+            DISTANCE(dict, next, dict->hashtab[next].hash) == 0)
+            break;
+        dict->hashtab[pos] = dict->hashtab[next];
+        pos = next;
+    }
+    dict->hashtab[pos].index = -1;
+}
+
+/* Returns the slot holding key, or F_FAILURE. */
+static Int search(const cDict *dict, cData *key, uLong hash) {
+    const struct dict_slot *slot;
+    Int pos, dist;
+
+    pos = hash & HASHTAB_MASK(dict);
+    for (dist = 0;; pos = (pos + 1) & HASHTAB_MASK(dict), dist++) {
+        slot = &dict->hashtab[pos];
+        if (slot->index == -1 || DISTANCE(dict, pos, slot->hash) < dist)
+            return F_FAILURE;
+        if (slot->hash == hash &&
+            data_cmp(list_elem(dict->keys, slot->index), key) == 0)
+            return pos;
+    }
 }
 
 Int dict_size(const cDict *dict)
 {
-    return list_length(dict->keys);
+    return list_length(dict->keys) - dict->holes;
 }
 
 static void increase_hashtab_size(cDict *dict)
 {
-    Int i, newsize, oldsize = sizeof(Int) * dict->hashtab_size;
+    struct dict_slot *old = dict->hashtab;
+    Int i, oldsize = dict->hashtab_size;
 
-    if (dict->hashtab_size > 4096)
-        dict->hashtab_size += 4096;
-    else
-        dict->hashtab_size = dict->hashtab_size * 2 + MALLOC_DELTA;
-
-    newsize = sizeof(Int) * dict->hashtab_size;
-    dict->links   = trealloc(dict->links,   oldsize, newsize);
-    dict->hashtab = trealloc(dict->hashtab, oldsize, newsize);
-    memset(dict->links,   -1, newsize);
-    memset(dict->hashtab, -1, newsize);
-    for (i = 0; i < dict->keys->len; i++)
-        insert_key(dict, i);
+    alloc_hashtab(dict, oldsize * 2);
+    for (i = 0; i < oldsize; i++) {
+        if (old[i].index != -1)
+            insert_key(dict, old[i].index, old[i].hash);
+    }
+    tfree(old, sizeof(struct dict_slot) * oldsize);
+}
+
+static cDict *add_entry(cDict *dict, cData *key, cData *value, uLong hash)
+{
+    /* Add the key and value to the list. */
+    dict->keys = list_add(dict->keys, key);
+    dict->values = list_add(dict->values, value);
+
+    /* Check if we should resize the hash table. */
+    if (HASHTAB_FULL(dict, dict_size(dict)))
+        increase_hashtab_size(dict);
+    insert_key(dict, list_length(dict->keys) - 1, hash);
+    return dict;
+}
+
+/* Discard the entry at i, which no slot may refer to any longer. */
+static void make_hole(cDict *dict, Int i)
+{
+    cData hole;
+
+    hole.type = INTEGER;
+    hole.u.val = 0;
+    dict->keys = list_replace(dict->keys, i, &hole);
+    dict->values = list_replace(dict->values, i, &hole);
+    dict->holes++;
 }
 
 /* WARNING: This will discard both arguments! */
 cDict *dict_union (cDict *d1, cDict *d2) {
     int i, pos;
     bool swap;
+    cData *key, *value;
+    uLong hash;
 
-    if (d2->keys->len > d1->keys->len) {
+    if (dict_size(d2) > dict_size(d1)) {
         cDict *t;
         t=d2; d2=d1; d1=t;
         swap = false;
@@ -349,32 +457,27 @@ cDict *dict_union (cDict *d1, cDict *d2) {
     }
 
     d1=dict_prep(d1);
+    dict_compact(d2);
 
-    for (i=0; i<d2->keys->len; i++) {
-        cData *key=&d2->keys->el[i], *value=&d2->values->el[i];
+    for (i=0; i<list_length(d2->keys); i++) {
+        key = list_elem(d2->keys, i);
+        value = list_elem(d2->values, i);
+        hash = hash_key(key);
 
-        pos = search(d1, key);
+        pos = search(d1, key, hash);
 
         /* forget the add if it's already there */
         if (pos != F_FAILURE) {
             /* ... but if the args are in the wrong order, we
                want to overwrite the key */
             if (swap)
-                d1->values = list_replace(d1->values, pos, value);
+                d1->values = list_replace(d1->values, d1->hashtab[pos].index,
+                                          value);
             continue;
         }
 
-        /* Add the key and value to the list. */
-        d1->keys = list_add(d1->keys, key);
-        d1->values = list_add(d1->values, value);
-
-        /* Check if we should resize the hash table. */
-        if (d1->keys->len > d1->hashtab_size)
-            increase_hashtab_size(d1);
-        else
-            insert_key(d1, d1->keys->len - 1);
+        d1 = add_entry(d1, key, value, hash);
     }
     dict_discard(d2);
     return d1;
 }
-
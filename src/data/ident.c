@@ -18,7 +18,7 @@ Ident perm_id, type_id, div_id, integer_id, float_id, string_id, objnum_id,
       address_id, refused_id, net_id, timeout_id, other_id, failed_id,
       heartbeat_id, regexp_id, buffer_id, object_id, namenf_id, salt_id,
       function_id, opcode_id, method_id, interpreter_id, signal_id,
-      directory_id, eof_id, backup_done_id;
+      directory_id, eof_id, backup_done_id, sorted_id;
 
 Ident public_id, protected_id, private_id, root_id, driver_id, fpe_id, inf_id,
       noover_id, sync_id, locked_id, native_id, forked_id, atomic_id;
@@ -33,6 +33,7 @@ Ident left_id, right_id, both_id;
 /* config options */
 Ident cachelog_id, cachewatch_id, cachewatchcount_id, cleanerwait_id, cleanerignore_id;
 Ident log_malloc_size_id, log_method_cache_id, cache_history_size_id;
+Ident method_cache_size_id;
 
 /* cache stats options */
 Ident ancestor_cache_id, method_cache_id, name_cache_id, object_cache_id;
@@ -105,6 +106,7 @@ void init_ident(void)
     native_id = ident_get("native");
     atomic_id = ident_get("atomic");
     backup_done_id = ident_get("backup_done");
+    sorted_id = ident_get("sorted");
     SEEK_SET_id = ident_get("SEEK_SET");
     SEEK_CUR_id = ident_get("SEEK_CUR");
     SEEK_END_id = ident_get("SEEK_END");
@@ -126,6 +128,7 @@ void init_ident(void)
     log_malloc_size_id = ident_get("log_malloc_size");
     log_method_cache_id = ident_get("log_method_cache");
     cache_history_size_id = ident_get("cache_history_size");
+    method_cache_size_id = ident_get("method_cache_size");
 
     ancestor_cache_id = ident_get("ancestor_cache");
     method_cache_id = ident_get("method_cache");
@@ -9,6 +9,7 @@
 
 #include "defs.h"
 #include "quickhash.h"
+#include "util.h"
 #include "macros.h"
 
 extern Int list_length(const cList *list);
@@ -30,6 +31,9 @@ static cList *generic_empty_list;
 #define MALLOC_DELTA    3
 #define STARTING_SIZE   (16 - MALLOC_DELTA)
 
+/* Shorter lists are cheaper to copy than to share. */
+#define SHARE_MIN_LENGTH 64
+
 /* Input to this routine should be a list you want to modify, a start, and a
  * length.  The start gives the offset from list->el at which you start being
  * interested in data; the length is the amount of data there will be in the
@@ -53,13 +57,17 @@ cList * list_prep(cList *list, Int start, Int len) {
     Int      i,
              resize;
 
+    list = list_flat(list);
+
     /* Figure out if we need to resize the list or move its contents.  Moving
      * contents takes precedence. */
     resize = list->size < len + start;
 
 
-    /* Move the list contents into a new list. */
-    if ((list->refs > 1) || (resize && start > 0)) {
+    /* Move the list contents into a new list.  A sublist sharing the
+     * elements of another (list->left) must always move. */
+    if (list->refs > 1 || list->left ||
+        (resize && list->el != list->elems)) {
         cnew = list_new(len);
         cnew->len = len;
         len = (list->len < len) ? list->len : len;
@@ -69,11 +77,22 @@ cList * list_prep(cList *list, Int start, Int len) {
         return cnew;
     }
 
-    /* Resize the list.  We can assume that list->start == start == 0. */
+    /* Resize the list, first moving its contents down to list->el[0], as
+     * when it is used as a queue.  The space freed at the front is often
+     * enough, and growing it otherwise keeps the moves rare. */
     else if (resize) {
+        for (; list->start < start; list->start++, list->len--)
+            data_discard(&list->el[list->start]);
         for (; list->len > len; list->len--)
-            data_discard(&list->el[list->len - 1]);
+            data_discard(&list->el[list->start + list->len - 1]);
+        if (start > 0) {
+            MEMMOVE(list->el, list->el + start, list->len);
+            list->start = 0;
+        }
         list->len = len;
+        list->hash = 0;
+        if (list->size >= len)
+            return list;
         while (list->size < len)
         {
             if (list->size > 4096)
@@ -83,6 +102,7 @@ cList * list_prep(cList *list, Int start, Int len) {
         }
         list = (cList *) erealloc(list, sizeof(cList) +
                                         (list->size * sizeof(cData)));
+        list->el = list->elems;
         return list;
     }
 
@@ -93,6 +113,7 @@ cList * list_prep(cList *list, Int start, Int len) {
             data_discard(&list->el[list->start + list->len - 1]);
         list->start = start;
         list->len = len;
+        list->hash = 0;
         return list;
     }
 }
@@ -109,6 +130,9 @@ cList *list_new(Int len) {
     cnew->start = 0;
     cnew->size = len;
     cnew->refs = 1;
+    cnew->hash = 0;
+    cnew->left = cnew->right = NULL;
+    cnew->el = cnew->elems;
 
     if (len == 0 && !generic_empty_list)
         generic_empty_list = list_dup(cnew);
@@ -126,12 +150,14 @@ cList *list_dup(cList *list) {
  * Don't manipulate <list> until you're done. */
 cData * list_empty_spaces(cList *list, Int spaces) {
     list->len += spaces;
+    list->hash = 0;
     return list->el + list->start + list->len - spaces;
 }
 
 Int list_search(cList *list, cData *data) {
     cData *d, *start, *end;
 
+    list = list_flat(list);
     start = list->el + list->start;
     end = start + list->len;
     for (d = start; d < end; d++) {
@@ -160,6 +186,7 @@ Int list_binary_search(cList * list, cData *data, cData *key) {
     int start, end, middle;
     int result;
 
+    list = list_flat(list);
     d = list->el + list->start;
     start = 0;
     end = list->len - 1;
@@ -189,6 +216,9 @@ Int list_cmp(cList *l1, cList *l2) {
     if (l1->len != l2->len)
         return 1;
 
+    l1 = list_flat(l1);
+    l2 = list_flat(l2);
+
     /* See if any elements differ. */
     for (i = 0; i < l1->len; i++) {
         if ((k=data_cmp(&l1->el[l1->start + i], &l2->el[l2->start + i])) != 0)
@@ -219,6 +249,7 @@ cList *list_add_sorted(cList *list, cData *elem, cData *key) {
     int start, end, middle;
     int result, idx;
 
+    list = list_flat(list);
     d = list->el + list->start;
     start = 0;
     end = list->len - 1;
@@ -250,29 +281,33 @@ cList *list_add_sorted(cList *list, cData *elem, cData *key) {
 
 /* Error-checking on pos is the job of the calling function. */
 cList *list_replace(cList *list, Int pos, const cData *elem) {
-    /* list_prep needed here only for multiply referenced lists */
-    if (list->refs > 1)
+    /* list_prep needed here only for multiply referenced or shared lists */
+    if (list->refs > 1 || list->left)
       list = list_prep(list, list->start, list->len);
     pos += list->start;
     data_discard(&list->el[pos]);
     data_dup(&list->el[pos], elem);
+    list->hash = 0;
     return list;
 }
 
 /* Error-checking on pos is the job of the calling function. */
 cList *list_delete(cList *list, Int pos) {
-    /* Special-case deletion of last element. */
+    /* Special-case deletion of last and first elements. */
     if (pos == list->len - 1)
         return list_prep(list, list->start, list->len - 1);
+    if (pos == 0)
+        return list_prep(list, list->start + 1, list->len - 1);
 
-    /* list_prep needed here only for multiply referenced lists */
-    if (list->refs > 1)
+    /* list_prep needed here only for multiply referenced or shared lists */
+    if (list->refs > 1 || list->left)
         list = list_prep(list, list->start, list->len);
 
     pos += list->start;
     data_discard(&list->el[pos]);
     MEMMOVE(list->el + pos, list->el + pos + 1, list->len - pos);
     list->len--;
+    list->hash = 0;
 
     /* list_prep needed here only if list has shrunk */
     if (((list->len - list->start) * 4 < list->size) &&
@@ -299,6 +334,7 @@ cList *list_append(cList *list1, const cList *list2) {
     cData *p;
     const cData *q;
 
+    list2 = list_flat(list2);
     list1 = list_prep(list1, list1->start, list1->len + list2->len);
     p = list1->el + list1->start + list1->len - list2->len;
     q = list2->el + list2->start;
@@ -307,12 +343,70 @@ cList *list_append(cList *list1, const cList *list2) {
     return list1;
 }
 
+/*
+// list_append() for the interpreter, where list1 is often held by an object
+// variable as well as the stack, as in "log = log + [entry]" or a method
+// which is passed the list and returns it with entry added, and would be
+// copied for every entry added.  If list1 is long and shared, or is
+// already such a concatenation, return a cList which refers to both halves
+// instead, whose elements are copied together by list_flatten() when they
+// are wanted.
+//
+// Only the left half is ever a concatenation, so that list_flatten() and
+// list_discard() can follow a long chain of them without recursing.
+*/
+cList *list_concat(cList *list1, cList *list2) {
+    cList *cnew;
+
+    if (list1->el && (list1->refs == 1 || list1->len < SHARE_MIN_LENGTH))
+        return list_append(list1, list2);
+
+    cnew = (cList *) emalloc(sizeof(cList));
+    cnew->start = 0;
+    cnew->len = list1->len + list2->len;
+    cnew->size = 0;
+    cnew->refs = 1;
+    cnew->hash = 0;
+    cnew->left = list1;
+    cnew->right = list_dup(list_flat(list2));
+    cnew->el = NULL;
+    return cnew;
+}
+
+/* Copy the elements of a concatenation together, in place, as its other
+ * holders still refer to it. */
+cList *list_flatten(cList *list) {
+    cData *el, *end, *d;
+    cList *node, *piece;
+    Int i;
+
+    el = EMALLOC(cData, list->len);
+    end = el + list->len;
+    for (node = list; !node->el; node = node->left) {
+        piece = node->right;
+        end -= piece->len;
+        d = piece->el + piece->start;
+        for (i = 0; i < piece->len; i++)
+            data_dup(&end[i], &d[i]);
+    }
+    d = node->el + node->start;
+    for (i = 0; i < node->len; i++)
+        data_dup(&el[i], &d[i]);
+
+    list_discard(list->left);
+    list_discard(list->right);
+    list->left = list->right = NULL;
+    list->el = el;
+    list->size = list->len;
+    return list;
+}
+
 cList *list_reverse(cList *list) {
     cData *d, tmp;
     Int i;
 
-    /* list_prep needed here only for multiply referenced lists */
-    if (list->refs > 1)
+    /* list_prep needed here only for multiply referenced or shared lists */
+    if (list->refs > 1 || list->left)
         list = list_prep(list, list->start, list->len);
 
     d = list->el + list->start;
@@ -321,6 +415,7 @@ cList *list_reverse(cList *list) {
         d[i] = d[list->len - i - 1];
         d[list->len - i - 1] = tmp;
     }
+    list->hash = 0;
     return list;
 }
 
@@ -340,6 +435,7 @@ cList *list_setremove(cList *list, cData *d) {
 cList *list_union(cList *list1, cList *list2) {
     cData *start, *end, *d;
 
+    list2 = list_flat(list2);
     start = list2->el + list2->start;
     end = start + list2->len;
     if (list1->len + list2->len < 12) {
@@ -350,6 +446,8 @@ cList *list_union(cList *list1, cList *list2) {
     } else {
         Hash * tmp;
 
+        /* hash_new_with() removes duplicates from the list it is given */
+        list1 = list_prep(list1, list1->start, list1->len);
         tmp = hash_new_with(list1);
         list_discard(list1);
         for (d = start; d < end; d++) {
@@ -361,18 +459,68 @@ cList *list_union(cList *list1, cList *list2) {
     return list1;
 }
 
+/* A long sublist of a shared list, such as the rest of a list after its
+ * first element, shares the elements of the list it was taken from rather
+ * than copying them.  The sublist moves them out on its first change (see
+ * list_prep()), and keeps the other list alive until then. */
 cList *list_sublist(cList *list, Int start, Int len) {
-    return list_prep(list, list->start + start, len);
+    cList *cnew;
+
+    if (list->refs == 1 && list->left && list->el) {
+        list->start += start;
+        list->len = len;
+        list->hash = 0;
+        return list;
+    }
+
+    if (list->refs == 1 || len < SHARE_MIN_LENGTH || len * 2 < list->len)
+        return list_prep(list, list->start + start, len);
+
+    list = list_flat(list);
+    cnew = (cList *) emalloc(sizeof(cList));
+    cnew->start = list->start + start;
+    cnew->len = len;
+    cnew->size = 0;
+    cnew->refs = 1;
+    cnew->hash = 0;
+    cnew->left = list_dup(list->left ? list->left : list);
+    cnew->right = NULL;
+    cnew->el = list->el;
+    list_discard(list);
+    return cnew;
 }
 
 /* Warning: do not discard a list before initializing its data elements. */
+/* Hash the elements of list in order, as list_cmp() compares them. */
+uLong list_hash(cList *list) {
+    cData *d;
+    uLong hash;
+
+    if (!list->hash) {
+        hash = list->len;
+        for (d = list_first(list); d; d = list_next(list, d))
+            hash = hash_combine(hash, data_hash(d));
+        list->hash = hash ? hash : 1;
+    }
+    return list->hash;
+}
+
 void list_discard(cList *list) {
+    cList *left;
     Int i;
 
-    if (!--list->refs) {
-        for (i = list->start; i < list->start + list->len; i++)
-            data_discard(&list->el[i]);
+    while (list && !--list->refs) {
+        left = list->left;
+        if (!list->el) {
+            list_discard(list->right);
+        } else if (!left) {
+            for (i = list->start; i < list->start + list->len; i++)
+                data_discard(&list->el[i]);
+            if (list->el != list->elems)
+                efree(list->el);
+        }
         efree(list);
+        list = left;
     }
 }
 
@@ -440,6 +588,7 @@ int list_index(cList * list, cData * search, int origin) {
         return 0;
 
     origin--;
+    list = list_flat(list);
     start = list->el + list->start;
     end = start + list->len;
 
@@ -12,8 +12,6 @@
 #include "log.h"
 #include "quickhash.h"
 
-#define MAGIC_NUMBER 1000003
-
 Int ancestor_cache_hits = 0;
 Int ancestor_cache_sets = 0;
 Int ancestor_cache_misses = 0;
@@ -52,45 +50,63 @@ static const uLong RESET_SEARCH_AT = ~0;
         cache_search = START_SEARCH_AT; \
     cache_search++
 #define END_SEARCH()
-#define RETRIEVE_ONCE_OR_RETURN(_obj__, _objnum__) \
-    _obj__ = cache_retrieve(_objnum__); \
-    if (SEARCHED(_obj__)) { \
-        cache_discard(_obj__); \
-        return; \
-    } \
-    HAVE_SEARCHED(_obj__)
 
 
 /* ..................................................................... */
 /* types and structures */
 
-/* cData for method searches. */
-typedef struct search_params Search_params;
-
-struct search_params {
-    uLong name;
-    Long stop_at;
-    bool done;
-    IsFrob is_frob;
-    Method * last_method_found;
-};
-
-struct {
+struct method_cache_entry {
     Long stamp;
+    Long obj_stamp;
     cObjnum objnum;
     Ident name;
     IsFrob is_frob;
     bool failed;
     cObjnum after;
     cObjnum loc;
-} method_cache[METHOD_CACHE_SIZE];
+};
 
-struct {
-    Long stamp;
-    cObjnum objnum;
-    cObjnum ancestor;
-    bool is_ancestor;
-} ancestor_cache[ANCESTOR_CACHE_SIZE];
+/* The method cache is in sets of METHOD_CACHE_WAYS entries, each set kept
+ * in order of use, the most recent first.  It is allocated when first
+ * used, with method_cache_size entries. */
+static struct method_cache_entry *method_cache = NULL;
+static uLong method_cache_mask;         /* the number of sets, less one */
+
+/* An entry is only good while obj_stamp matches the stamp for the object
+ * the search started from, so changing one object's methods need only
+ * bump its stamp rather than look for its entries.  Vtables keep the
+ * stamps of all the objects they searched, and check them the same way. */
+Long method_obj_stamps[METHOD_STAMP_SIZE];
+
+#define OBJ_STAMP(_objnum_) METHOD_OBJ_STAMP(_objnum_)
+
+/* The ancestry index: every ancestor of each object asked about, sorted,
+ * so that object_has_ancestor() is a search of one array.  An entry is
+ * good while the stamps of the object and of each of its ancestors are as
+ * they were when it was made; changing an object's parents bumps its
+ * stamp, so only the entries for it and its descendants are made again.
+ * Entries are kept for objects not in the cache, and are found by objnum
+ * in an open hash. */
+struct anc_entry {
+    cObjnum   objnum;           /* INV_OBJNUM if unused */
+    Long      epoch;            /* ancestry_epoch when last found good */
+    Long      stamp;            /* the object's own stamp */
+    Int       num;
+    cObjnum * ancestors;
+    Long    * stamps;
+};
+
+static struct anc_entry * anc_index;
+static Int anc_index_size;
+static Int anc_index_used;
+
+static Long anc_stamps[ANCESTOR_STAMP_SIZE];
+
+#define ANC_STAMP(_objnum_) \
+    anc_stamps[(uLong) (_objnum_) % ANCESTOR_STAMP_SIZE]
+
+/* Bumped with any object's stamp, as method_epoch is for vtables. */
+static Long ancestry_epoch = 1;
 
 static ObjExtrasTable *object_extras = NULL;
 static int object_extras_count       = 0;
@@ -99,7 +115,8 @@ static int object_extras_count       = 0;
 /* function prototypes */
 static void    object_update_parents(Obj *object,
                                      cList *(*list_op)(cList *, cData *));
-static bool    object_has_ancestor_aux(cObjnum objnum, cObjnum ancestor);
+static struct anc_entry *ancestry_entry(cObjnum objnum);
+static void    ancestry_forget(cObjnum objnum);
 static Var    *object_create_var(Obj *object, cObjnum cclass, Ident name);
 static Var    *object_find_var(Obj *object, cObjnum cclass, Ident name);
 static bool    method_cache_check(cObjnum objnum, Ident name, cObjnum after,
@@ -108,12 +125,13 @@ static void    method_cache_set(cObjnum objnum, Ident name, cObjnum after,
                                 Long loc, IsFrob is_frob, bool failed);
 static void    method_cache_invalidate(cObjnum objnum);
 static void    method_cache_invalidate_all(void);
-static void    search_object(cObjnum objnum, Search_params *params);
+static ObjVtable *object_vtable(Obj *object);
+static void    vtable_linearize(cObjnum objnum, ObjVtable *vt);
+static Method *vtable_find_method(Obj *object, Ident name, cObjnum after,
+                                  IsFrob is_frob);
+static void    object_free_vtable(Obj *object);
+static void    method_cache_invalidate_object(Obj *object);
 static void    method_delete_code_refs(Method * method);
-static bool    ancestor_cache_check(cObjnum objnum, cObjnum ancestor,
-                                    bool *is_ancestor);
-static void    ancestor_cache_set(cObjnum objnum, cObjnum ancestor,
-                                  bool is_ancestor);
 
 /* ..................................................................... */
 /* global variables */
@@ -128,7 +146,20 @@ Long num_objects;
 /* Validity count for method cache (incrementing this count invalidates all
  * cache entries. */
 static Long cur_stamp = 2;
-static Long cur_anc_stamp = 2;
+
+/* Validity count for the per-call-site caches (see call_method()).  Bumped
+ * when the whole method cache is invalidated and when a method is deleted;
+ * a change to one object's methods bumps its stamp instead. */
+Long method_generation = 1;
+
+/* The last vars_version given to an object (see object_var_slot()). */
+uint64_t vars_versions = 0;
+
+#define VARS_CHANGED(_obj_) ((_obj_)->vars_version = ++vars_versions)
+
+/* Bumped with any object's stamp, so that a vtable need only check the
+ * stamps of its ancestors when this has changed since it last did. */
+static Long method_epoch = 1;
 
 cList * ancestor_cache_info(void)
 {
@@ -137,8 +168,8 @@ cList * ancestor_cache_info(void)
     Int used_buckets, i;
 
     used_buckets = 0;
-    for (i = 0; i < ANCESTOR_CACHE_SIZE; i++) {
-        if (ancestor_cache[i].stamp == cur_anc_stamp)
+    for (i = 0; i < anc_index_size; i++) {
+        if (anc_index[i].objnum != INV_OBJNUM && anc_index[i].num >= 0)
             used_buckets++;
     }
 
@@ -158,12 +189,13 @@ cList * ancestor_cache_info(void)
     d[5].type = INTEGER;
     d[5].u.val = used_buckets;
     d[6].type = INTEGER;
-    d[6].u.val = ANCESTOR_CACHE_SIZE;
+    d[6].u.val = anc_index_size;
 
     return entry;
 }
 
-static inline void ancestor_cache_invalidate(void)
+/* objnum's parents have changed, or it has been made or destroyed. */
+static inline void ancestor_cache_invalidate(cObjnum objnum)
 {
 #ifdef USE_CACHE_HISTORY
     cList * entry;
@@ -195,7 +227,8 @@ static inline void ancestor_cache_invalidate(void)
     ancestor_cache_misses = 0;
     ancestor_cache_sets = 0;
     ancestor_cache_collisions = 0;
-    cur_anc_stamp++;
+    ANC_STAMP(objnum)++;
+    ancestry_epoch++;
 }
 
 /*
@@ -252,6 +285,9 @@ Obj * object_new(cObjnum objnum, cList * parents) {
     /* Add this object to the children list of parents. */
     object_update_parents(cnew, list_add);
 
+    /* Its parents are at hand, so index its ancestors now. */
+    ancestry_entry(cnew->objnum);
+
     /* last still, which is ok, since coming out the gate its active and the
      * cleaner thread should ignore it anyway
      */
@@ -298,6 +334,8 @@ void object_alloc_methods(Obj *object) {
 void object_free(Obj *object) {
     Int i;
 
+    object_free_vtable(object);
+
     /* Free parents and children list. */
     list_discard(object->parents);
     object->parents = NULL;
@@ -320,11 +358,33 @@ void object_free(Obj *object) {
     efree(object->vars.tab);
     efree(object->vars.hashtab);
 
-    /* Free methods. */
+    object_free_methods(object);
+}
+
+/* Free an object's methods and the tables their code refers to, without
+ * deleting the references one by one.  Methods still held by call-site
+ * caches are left to them, with no object. */
+void object_free_methods(Obj *object) {
+    Method *method;
+    Int i;
+
     if (object->methods) {
+        /* First let go of what these methods' call sites hold, which may
+         * be other methods here. */
         for (i = 0; i < object->methods->size; i++) {
             if (object->methods->tab[i].m)
-                method_free(object->methods->tab[i].m);
+                method_forget_calls(object->methods->tab[i].m);
+        }
+        for (i = 0; i < object->methods->size; i++) {
+            method = object->methods->tab[i].m;
+            if (!method)
+                continue;
+            if (method->refs == 1) {
+                method_free(method);
+            } else {
+                method->object = NULL;
+                method->refs--;
+            }
         }
         efree(object->methods->tab);
         efree(object->methods->hashtab);
@@ -446,12 +506,14 @@ void object_destroy(Obj *object) {
 
     if (object->children && list_length(object->children) != 0) {
         /* Invalidate the method cache if object is not a leaf object */
-        method_cache_invalidate_all();
+        method_cache_invalidate_object(object);
 
         /* Invalidate the ancestor cache if the object has any children */
-        ancestor_cache_invalidate();
+        ancestor_cache_invalidate(object->objnum);
     }
 
+    ancestry_forget(object->objnum);
+
     /* remove the object name, if it has one */
     object_del_objname(object);
 
@@ -549,7 +611,7 @@ static Hash * object_ancestors_depth_aux(cObjnum objnum, Hash * h) {
     cData    this;
     cList  * parents;
 
-    obj = cache_retrieve(objnum);
+    obj = cache_retrieve_parents(objnum);
     if (SEARCHED(obj)) {
         cache_discard(obj);
         return h;
@@ -613,7 +675,7 @@ cList * object_ancestors_breadth(cObjnum objnum) {
 
     for (pos=0; list_length(h->keys) > pos; pos++) {
         c = list_elem(h->keys, pos);
-        parent = cache_retrieve(c->u.objnum);
+        parent = cache_retrieve_parents(c->u.objnum);
 
         if (SEARCHED(parent)) {
             cache_discard(parent);
@@ -638,108 +700,159 @@ cList * object_ancestors_breadth(cObjnum objnum) {
     return list;
 }
 
-static bool ancestor_cache_check(cObjnum objnum, cObjnum ancestor,
-                                 bool *is_ancestor)
-{
+/* The slot for objnum in the ancestry index, or the unused one it would
+ * go in. */
+static struct anc_entry *ancestry_slot(cObjnum objnum) {
+    struct anc_entry *e;
     uLong i;
 
-    i = (uLong)(objnum  + (ancestor * MAGIC_NUMBER)) % ANCESTOR_CACHE_SIZE;
-
-    if ((ancestor_cache[i].stamp == cur_anc_stamp) &&
-        (ancestor_cache[i].objnum == objnum) &&
-        (ancestor_cache[i].ancestor == ancestor))
-    {
-        *is_ancestor = ancestor_cache[i].is_ancestor;
-        ancestor_cache_hits++;
-        return true;
+    i = ((uLong) objnum * 2654435761UL) & (anc_index_size - 1);
+    for (;; i = (i + 1) & (anc_index_size - 1)) {
+        e = &anc_index[i];
+        if (e->objnum == objnum || e->objnum == INV_OBJNUM)
+            return e;
     }
-
-    ancestor_cache_misses++;
-    return false;
 }
 
-static void ancestor_cache_set(cObjnum objnum, cObjnum ancestor,
-                               bool is_ancestor)
-{
-    uLong i;
-
-    i = (uLong)(objnum + (ancestor * MAGIC_NUMBER)) % ANCESTOR_CACHE_SIZE;
-
-    if (ancestor_cache[i].stamp == cur_anc_stamp)
-        ancestor_cache_collisions++;
-
-    ancestor_cache[i].stamp = cur_anc_stamp;
-    ancestor_cache[i].objnum = objnum;
-    ancestor_cache[i].ancestor = ancestor;
-    ancestor_cache[i].is_ancestor = is_ancestor;
-
-    ancestor_cache_sets++;
+static void ancestry_grow(void) {
+    struct anc_entry *old = anc_index, *e;
+    Int old_size = anc_index_size, i;
+
+    anc_index_size = old_size ? old_size * 2 : 1024;
+    anc_index = EMALLOC(struct anc_entry, anc_index_size);
+    for (i = 0; i < anc_index_size; i++)
+        anc_index[i].objnum = INV_OBJNUM;
+    for (i = 0; i < old_size; i++) {
+        if (old[i].objnum != INV_OBJNUM) {
+            e = ancestry_slot(old[i].objnum);
+            *e = old[i];
+        }
+    }
+    if (old)
+        efree(old);
 }
 
-bool object_has_ancestor(cObjnum objnum, cObjnum ancestor)
-{
-    bool retv;
-    bool anc_cache_check;
+static int objnum_compare(const void *a, const void *b) {
+    cObjnum x = *(const cObjnum *) a, y = *(const cObjnum *) b;
 
-    if (objnum == ancestor)
-        return true;
-
-    if (ancestor_cache_check(objnum, ancestor, &anc_cache_check))
-        return anc_cache_check;
-
-    START_SEARCH();
-    retv = object_has_ancestor_aux(objnum, ancestor);
-    ancestor_cache_set(objnum, ancestor, retv);
-    END_SEARCH();
-    return retv;
+    return (x > y) - (x < y);
 }
 
-static bool object_has_ancestor_aux(cObjnum objnum, cObjnum ancestor)
-{
+/* The entry for objnum, made again if it is out of date, or NULL if there
+ * is no such object.  Its parents are read, from disk if they must be,
+ * only when the entry is made. */
+static struct anc_entry *ancestry_entry(cObjnum objnum) {
+    struct anc_entry *e, *pe;
     Obj *object;
     cList *parents;
     cData *d;
-    bool anc_cache_check;
-
-    /* Don't search an object twice. */
-    object = cache_retrieve(objnum);
-    if (SEARCHED(object)) {
-        cache_discard(object);
-        return false;
+    cObjnum *ancestors;
+    Int num, size, i, j;
+
+    if (anc_index_size) {
+        e = ancestry_slot(objnum);
+        if (e->objnum == objnum && e->num >= 0 &&
+            e->stamp == ANC_STAMP(objnum)) {
+            if (e->epoch == ancestry_epoch) {
+                ancestor_cache_hits++;
+                return e;
+            }
+            for (i = 0; i < e->num; i++) {
+                if (e->stamps[i] != ANC_STAMP(e->ancestors[i]))
+                    break;
+            }
+            if (i == e->num) {
+                e->epoch = ancestry_epoch;
+                ancestor_cache_hits++;
+                return e;
+            }
+            ancestor_cache_collisions++;
+        }
     }
-    HAVE_SEARCHED(object);
+    ancestor_cache_misses++;
 
+    object = cache_retrieve_parents(objnum);
+    if (!object)
+        return NULL;
     parents = list_dup(object->parents);
     cache_discard(object);
 
+    /* The parents and all of their ancestors.  The entries for the parents
+     * may move as they are made, so take what is needed from each at once. */
+    size = ANCTEMP_STARTING_SIZE;
+    ancestors = EMALLOC(cObjnum, size);
+    num = 0;
     for (d = list_first(parents); d; d = list_next(parents, d)) {
-        /* Do this check first since it is trivial
-         * The result of this will be cached in the
-         * caller. */
-        if (d->u.objnum == ancestor) {
-            list_discard(parents);
-            return true;
+        pe = ancestry_entry(d->u.objnum);
+        while (num + (pe ? pe->num : 0) + 1 > size) {
+            size = size * 2 + MALLOC_DELTA;
+            ancestors = EREALLOC(ancestors, cObjnum, size);
         }
-        /* Only fall out if the test is true, since other parents may
-           have a true result. */
-        if (ancestor_cache_check(d->u.objnum, ancestor, &anc_cache_check) &&
-            anc_cache_check) {
-            list_discard(parents);
-            return anc_cache_check;
+        ancestors[num++] = d->u.objnum;
+        if (pe) {
+            MEMCPY(&ancestors[num], pe->ancestors, pe->num);
+            num += pe->num;
         }
     }
+    list_discard(parents);
 
-    for (d = list_first(parents); d; d = list_next(parents, d)) {
-        if (object_has_ancestor_aux(d->u.objnum, ancestor)) {
-            ancestor_cache_set(d->u.objnum, ancestor, true);
-            list_discard(parents);
-            return true;
+    qsort(ancestors, num, sizeof(cObjnum), objnum_compare);
+    for (i = j = 0; i < num; i++) {
+        if (!j || ancestors[j - 1] != ancestors[i])
+            ancestors[j++] = ancestors[i];
+    }
+    num = j;
+
+    if ((anc_index_used + 1) * 4 > anc_index_size * 3)
+        ancestry_grow();
+    e = ancestry_slot(objnum);
+    if (e->objnum == objnum) {
+        if (e->num >= 0) {
+            efree(e->ancestors);
+            efree(e->stamps);
         }
+    } else {
+        e->objnum = objnum;
+        anc_index_used++;
     }
+    e->epoch = ancestry_epoch;
+    e->stamp = ANC_STAMP(objnum);
+    e->num = num;
+    e->ancestors = EREALLOC(ancestors, cObjnum, num ? num : 1);
+    e->stamps = EMALLOC(Long, num ? num : 1);
+    for (i = 0; i < num; i++)
+        e->stamps[i] = ANC_STAMP(e->ancestors[i]);
+    ancestor_cache_sets++;
 
-    ancestor_cache_set(objnum, ancestor, false);
-    list_discard(parents);
-    return false;
+    return e;
+}
+
+/* Let go of what the index has for an object which has been destroyed. */
+static void ancestry_forget(cObjnum objnum) {
+    struct anc_entry *e;
+
+    if (!anc_index_size)
+        return;
+    e = ancestry_slot(objnum);
+    if (e->objnum == objnum && e->num >= 0) {
+        efree(e->ancestors);
+        efree(e->stamps);
+        e->num = -1;
+    }
+}
+
+bool object_has_ancestor(cObjnum objnum, cObjnum ancestor)
+{
+    struct anc_entry *e;
+
+    if (objnum == ancestor)
+        return true;
+
+    e = ancestry_entry(objnum);
+    if (!e)
+        return false;
+    return bsearch(&ancestor, e->ancestors, e->num, sizeof(cObjnum),
+                   objnum_compare) != NULL;
 }
 
 Int object_change_parents(Obj *object, cList *parents)
@@ -766,15 +879,10 @@ Int object_change_parents(Obj *object, cList *parents)
     }
 
     /* Invalidate the method cache. */
-    /* NOTE:  is there a better way to invalidate this? */
-    if (object->children && list_length(object->children) != 0) {
-        method_cache_invalidate_all();
-    } else {
-        method_cache_invalidate(object->objnum);
-    }
+    method_cache_invalidate_object(object);
 
     /* Invalidate the ancestor cache */
-    ancestor_cache_invalidate();
+    ancestor_cache_invalidate(object->objnum);
 
     cache_dirty_object(object);
 
@@ -915,6 +1023,7 @@ Ident object_del_var(Obj *object, Ident name)
         var = &object->vars.tab[*indp];
         if (var->name == name && var->cclass == object->objnum) {
             cache_dirty_object(object);
+            VARS_CHANGED(object);
 
             /*  write_err("##object_del_var %d %s", var->name, ident_name(var->name));*/
             ident_discard(var->name);
@@ -934,17 +1043,53 @@ Ident object_del_var(Obj *object, Ident name)
     return varnf_id;
 }
 
-Ident object_assign_var(Obj *object, Obj *cclass, Ident name, cData *val) {
+/* The slot for name, as defined by cclass, on object, or NULL if it has
+ * none; *defined is false if cclass does not define name.  cache, if not
+ * NULL, is the asking instruction's, which saves both lookups when it asks
+ * about an object it has asked about before and nothing has been added to
+ * or removed from either object's variables since. */
+static Var *object_var_slot(Obj *object, Obj *cclass, Ident name,
+                            Var_cache *cache, bool *defined)
+{
     Var *var;
 
+    if (cache && cache->objnum == object->objnum &&
+        cache->version == object->vars_version &&
+        cache->cclass_version == cclass->vars_version) {
+        *defined = true;
+        return &object->vars.tab[cache->slot];
+    }
+
     /* Make sure variable exists in cclass (method object). */
-    if (!object_find_var(cclass, cclass->objnum, name))
-        return varnf_id;
+    *defined = (object_find_var(cclass, cclass->objnum, name) != NULL);
+    if (!*defined)
+        return NULL;
 
-    /* Get variable slot on object, creating it if necessary. */
     var = object_find_var(object, cclass->objnum, name);
-    if (!var)
-        var = object_create_var(object, cclass->objnum, name);
+    if (var && cache) {
+        cache->objnum = object->objnum;
+        cache->version = object->vars_version;
+        cache->cclass_version = cclass->vars_version;
+        cache->slot = var - object->vars.tab;
+    }
+
+    return var;
+}
+
+Ident object_assign_var(Obj *object, Obj *cclass, Ident name, cData *val,
+                        Var_cache *cache)
+{
+    Var *var;
+    bool defined;
+
+    /* Get variable slot on object, creating it if necessary. */
+    var = object_var_slot(object, cclass, name, cache, &defined);
+    if (!defined)
+        return varnf_id;
+    if (!var) {
+        object_create_var(object, cclass->objnum, name);
+        var = object_var_slot(object, cclass, name, cache, &defined);
+    }
 
     cache_dirty_object(object);
 
@@ -970,6 +1115,7 @@ Ident object_delete_var(Obj *object, Obj *cclass, Ident name) {
             var = &object->vars.tab[*indp];
             if (var->name == name && var->cclass == cclass->objnum) {
                 cache_dirty_object(object);
+                VARS_CHANGED(object);
 
                 ident_discard(var->name);
                 data_discard(&var->val);
@@ -989,15 +1135,15 @@ Ident object_delete_var(Obj *object, Obj *cclass, Ident name) {
     return varnf_id;
 }
 
-Ident object_retrieve_var(Obj *object, Obj *cclass, Ident name, cData *ret)
+Ident object_retrieve_var(Obj *object, Obj *cclass, Ident name, cData *ret,
+                          Var_cache *cache)
 {
     Var *var;
+    bool defined;
 
-    /* Make sure variable exists on cclass. */
-    if (!object_find_var(cclass, cclass->objnum, name))
+    var = object_var_slot(object, cclass, name, cache, &defined);
+    if (!defined)
         return varnf_id;
-
-    var = object_find_var(object, cclass->objnum, name);
     if (var) {
         data_dup(ret, &var->val);
     } else {
@@ -1089,6 +1235,7 @@ static Var *object_create_var(Obj *object, cObjnum cclass, Ident name)
     Int ind;
 
     cache_dirty_object(object);
+    VARS_CHANGED(object);
 
     /* If the variable table is full, expand it and its corresponding hash
      * table. */
@@ -1175,20 +1322,9 @@ static Var *object_find_var(Obj *object, cObjnum cclass, Ident name)
 /* Reference-counting kludge: on return, the method's object field has an
    extra reference count, in order to keep it in cache.  objnum must be
    valid. */
-/* object_find_method is now a front end that increments the
-   cache_search variable and calls object_find_message_recurse,
-   the recursive routine.  This is necessary to make single-
-   inheritance lineage object re-entrant.  It fixes a bug in
-   the circular-definition catching logic that caused it to
-   fail when a parent's method sent a message to the child as
-   a result of a message to the child handled by the parent
-   (whew.) added 5/7/1995 Jeffrey P. kesselman */
 Method *object_find_method(cObjnum objnum, Ident name, IsFrob is_frob) {
-    Search_params   params;
     Obj           * object;
-    Method        * method, *local_method;
-    cList         * parents;
-    cData         * d;
+    Method        * method;
     bool            method_cache_hit;
 
     /* Look for cached value. */
@@ -1197,45 +1333,9 @@ Method *object_find_method(cObjnum objnum, Ident name, IsFrob is_frob) {
         return method;
 
     object = cache_retrieve(objnum);
-    parents = list_dup(object->parents);
+    method = vtable_find_method(object, name, -1, is_frob);
     cache_discard(object);
 
-    if (list_length(parents) != 0) {
-        /* If the object has parents */
-        if (list_length(parents) == 1) {
-            /* If it has only one parent, call this function recursively. */
-            method = object_find_method(list_elem(parents, 0)->u.objnum, name, is_frob);
-        } else {
-            /* We've hit a bulge; resort to the reverse depth-first search. */
-            START_SEARCH();
-            params.name = name;
-            params.stop_at = -1;
-            params.done = false;
-            params.last_method_found = NULL;
-            params.is_frob = is_frob;
-            for (d = list_last(parents); d; d = list_prev(parents, d))
-                search_object(d->u.objnum, &params);
-            method = params.last_method_found;
-            END_SEARCH();
-        }
-    }
-
-    list_discard(parents);
-
-    /* If we have not found a method defined above, or the top method we
-       have found is overridable */
-    if (!method || !(method->m_flags & MF_NOOVER)) {
-        object = cache_retrieve(objnum);
-        local_method = object_find_method_local(object, name, is_frob);
-        if (local_method) {
-            if (method)
-                cache_discard(method->object);
-            method = local_method;
-        } else {
-            cache_discard(object);
-        }
-    }
-
     method_cache_set(objnum, name, -1, (method ? method->object->objnum : -2), is_frob, (method ? false : true));
     return method;
 }
@@ -1245,12 +1345,8 @@ Method *object_find_method(cObjnum objnum, Ident name, IsFrob is_frob) {
 Method *object_find_next_method(cObjnum objnum, Ident name,
                                 cObjnum after, IsFrob is_frob)
 {
-    Search_params params;
     Obj *object;
     Method *method;
-    cList *parents;
-    cData *d;
-    cObjnum parent;
     bool method_cache_hit;
 
     /* Check cache. */
@@ -1259,48 +1355,76 @@ Method *object_find_next_method(cObjnum objnum, Ident name,
         return method;
 
     object = cache_retrieve(objnum);
-    parents = object->parents;
+    method = vtable_find_method(object, name, after, is_frob);
+    cache_discard(object);
 
-    if (list_length(parents) == 1) {
-        /* Object has only one parent; search recursively. */
-        parent = list_elem(parents, 0)->u.objnum;
-        cache_discard(object);
-        if (objnum == after)
-            method = object_find_method(parent, name, is_frob);
+    method_cache_set(objnum, name, after, (method ? method->object->objnum : -2), is_frob, (method ? false : true));
+    return method;
+}
+
+/*
+// -----------------------------------------------------------------
+//
+// An object's ancestors are searched in reverse depth-first order with no
+// repeat visits, thus searching ancestors before children and parents
+// right-to-left, and the object itself last.  The last method found is
+// the one used, unless a non-overridable one is found first.  Finding the
+// next method after a given object looks through the ancestors before it.
+//
+// The order is worked out once, when the object is first searched, and
+// where each method was found is remembered alongside it, so the search
+// itself need only be made once for each name.  Both are thrown away
+// when any object in the order has its stamp bumped, that is when its
+// methods or parents change (see method_cache_invalidate_object()).
+//
+*/
+static ObjVtable *object_vtable(Obj *object) {
+    ObjVtable *vt = object->vtable;
+    Int i;
+
+    if (vt && vt->epoch != method_epoch) {
+        for (i = 0; i < vt->num_ancestors; i++) {
+            if (vt->stamps[i] != OBJ_STAMP(vt->ancestors[i]))
+                break;
+        }
+        if (i < vt->num_ancestors)
+            object_free_vtable(object);
         else
-            method = object_find_next_method(parent, name, after, is_frob);
-    } else {
-        /* Object has more than one parent; use complicated search. */
-        START_SEARCH();
-        params.name = name;
-        params.stop_at = (objnum == after) ? -1 : after;
-        params.done = false;
-        params.last_method_found = NULL;
-        params.is_frob = is_frob;
-        for (d = list_last(parents); d; d = list_prev(parents, d))
-            search_object(d->u.objnum, &params);
-        cache_discard(object);
-        method = params.last_method_found;
-        END_SEARCH();
+            vt->epoch = method_epoch;
     }
 
-    method_cache_set(objnum, name, after, (method ? method->object->objnum : -2), is_frob, (method ? false : true));
-    return method;
+    if (!object->vtable) {
+        vt = EMALLOC(ObjVtable, 1);
+        vt->epoch = method_epoch;
+        vt->num_ancestors = 0;
+        vt->ancestors = EMALLOC(cObjnum, ANCTEMP_STARTING_SIZE);
+        vt->stamps = EMALLOC(Long, ANCTEMP_STARTING_SIZE);
+        vt->size = 0;
+        vt->used = 0;
+        vt->tab = NULL;
+
+        vtable_linearize(object->objnum, vt);
+
+        object->vtable = vt;
+    }
+
+    return object->vtable;
 }
 
-/* Perform a reverse depth-first traversal of this object and its ancestors
- * with no repeat visits, thus searching ancestors before children and
- * searching parents right-to-left.  We will take the last method we find,
- * possibly stopping at a method if we were looking for the next method after
- * a given method. */
-static void search_object(cObjnum objnum, Search_params *params)
-{
+static void vtable_linearize(cObjnum objnum, ObjVtable *vt) {
     Obj *object;
-    Method *method;
     cList *parents;
     cData *d;
+    Int n, m;
 
-    RETRIEVE_ONCE_OR_RETURN(object, objnum);
+    /* Visit each object once.  Checking the order so far, rather than
+     * marking objects as searched, still works when the search swaps out
+     * the objects it has visited. */
+    for (n = 0; n < vt->num_ancestors; n++) {
+        if (vt->ancestors[n] == objnum)
+            return;
+    }
+    object = cache_retrieve_parents(objnum);
 
     /* Grab the parents list and discard the object. */
     parents = list_dup(object->parents);
@@ -1308,42 +1432,165 @@ static void search_object(cObjnum objnum, Search_params *params)
 
     /* Traverse the parents list backwards. */
     for (d = list_last(parents); d; d = list_prev(parents, d))
-        search_object(d->u.objnum, params);
+        vtable_linearize(d->u.objnum, vt);
     list_discard(parents);
 
-    /* If the search is done, don't visit this object. */
-    if (params->done)
-        return;
+    /* The tables start at ANCTEMP_STARTING_SIZE and double each time they
+     * fill; ANCTEMP_STARTING_SIZE need not be a power of two. */
+    n = vt->num_ancestors;
+    m = n / ANCTEMP_STARTING_SIZE;
+    if (n && n % ANCTEMP_STARTING_SIZE == 0 && !(m & (m - 1))) {
+        vt->ancestors = EREALLOC(vt->ancestors, cObjnum, n * 2);
+        vt->stamps = EREALLOC(vt->stamps, Long, n * 2);
+    }
+    vt->ancestors[n] = objnum;
+    vt->stamps[n] = OBJ_STAMP(objnum);
+    vt->num_ancestors++;
+}
 
-    /* If we were searching for a next method after a given object, then this
-     * might be the given object, in which case we should stop. */
-    if (objnum == params->stop_at) {
-        params->done = true;
-        return;
+#define VTABLE_HASH(_name_, _after_, _is_frob_) \
+    ((uLong) (_name_) * 31 + (uLong) (_after_) * 7 + (uLong) (_is_frob_))
+
+static struct vtable_entry *vtable_entry(ObjVtable *vt, Ident name,
+                                         cObjnum after, Int is_frob)
+{
+    struct vtable_entry *e;
+    uLong i;
+
+    i = VTABLE_HASH(name, after, is_frob) & (vt->size - 1);
+    for (;; i = (i + 1) & (vt->size - 1)) {
+        e = &vt->tab[i];
+        if (e->name == NOT_AN_IDENT ||
+            (e->name == name && e->after == after && e->is_frob == is_frob))
+            return e;
     }
+}
 
-    /* Visit this object.  First, get it back from the cache. */
-    object = cache_retrieve(objnum);
-    method = object_find_method_local(object, params->name, params->is_frob);
-    if (method) {
-        /* We found a method on this object.  Discard the reference count on
-         * the last method found's object, if we have one, and set this method
-         * as the last one found.  Leave object's reference count there, since
-         * we don't want it to get swapped out. */
-        if (params->last_method_found)
-            cache_discard(params->last_method_found->object);
-        params->last_method_found = method;
-
-        /* If this method is non-overridable, the search is done. */
-        if (method->m_flags & MF_NOOVER)
-            params->done = true;
-    } else {
+static void vtable_grow(ObjVtable *vt) {
+    struct vtable_entry *old = vt->tab, *e;
+    Int old_size = vt->size, i;
+
+    vt->size = old_size ? old_size * 2 : 16;
+    vt->tab = EMALLOC(struct vtable_entry, vt->size);
+    for (i = 0; i < vt->size; i++)
+        vt->tab[i].name = NOT_AN_IDENT;
+    for (i = 0; i < old_size; i++) {
+        if (old[i].name != NOT_AN_IDENT) {
+            e = vtable_entry(vt, old[i].name, old[i].after, old[i].is_frob);
+            *e = old[i];
+        }
+    }
+    if (old)
+        efree(old);
+}
+
+/* Look through the object's ancestors, as described above, for the one
+ * name is to be found on. */
+static cObjnum vtable_search(ObjVtable *vt, Ident name, cObjnum after,
+                             IsFrob is_frob)
+{
+    Obj *object;
+    Method *method;
+    cObjnum loc = -2;
+    Int i, n;
+    bool noover;
+
+    /* The next method is never on the object itself. */
+    n = vt->num_ancestors - (after == -1 ? 0 : 1);
+    for (i = 0; i < n; i++) {
+        if (vt->ancestors[i] == after)
+            break;
+        object = cache_retrieve(vt->ancestors[i]);
+        if (!object)
+            continue;
+        method = object_find_method_header(object, name, is_frob);
+        noover = method && (method->m_flags & MF_NOOVER);
         cache_discard(object);
+        if (method) {
+            loc = vt->ancestors[i];
+            if (noover)
+                break;
+        }
     }
+
+    return loc;
 }
 
-/* Look for a method on an object. */
+/* The method for name as found from object, with an extra reference count
+ * on its object as for object_find_method(). */
+static Method *vtable_find_method(Obj *object, Ident name, cObjnum after,
+                                  IsFrob is_frob)
+{
+    ObjVtable *vt;
+    struct vtable_entry *e;
+    Obj *loc;
+    Method *method;
+
+    /* A retry only looks for methods which are not frob methods. */
+    if (is_frob == FROB_RETRY)
+        is_frob = FROB_NO;
+
+    vt = object_vtable(object);
+    if (!vt->size)
+        vtable_grow(vt);
+    e = vtable_entry(vt, name, after, is_frob);
+    if (e->name == NOT_AN_IDENT) {
+        if ((vt->used + 1) * 4 > vt->size * 3) {
+            vtable_grow(vt);
+            e = vtable_entry(vt, name, after, is_frob);
+        }
+        e->name = ident_dup(name);
+        e->after = after;
+        e->is_frob = is_frob;
+        e->loc = vtable_search(vt, name, after, is_frob);
+        vt->used++;
+    }
+
+    if (e->loc == -2)
+        return NULL;
+    loc = cache_retrieve(e->loc);
+    method = object_find_method_local(loc, name, is_frob);
+    if (!method)
+        cache_discard(loc);
+    return method;
+}
+
+static void object_free_vtable(Obj *object) {
+    ObjVtable *vt = object->vtable;
+    Int i;
+
+    if (!vt)
+        return;
+    for (i = 0; i < vt->size; i++) {
+        if (vt->tab[i].name != NOT_AN_IDENT)
+            ident_discard(vt->tab[i].name);
+    }
+    if (vt->tab)
+        efree(vt->tab);
+    efree(vt->ancestors);
+    efree(vt->stamps);
+    efree(vt);
+    object->vtable = NULL;
+}
+
+/* Look for a method on an object, decoding its body if it has not been
+ * used since the object was read from disk. */
 Method *object_find_method_local(const Obj *object, Ident name, IsFrob is_frob)
+{
+    Method *method;
+
+    method = object_find_method_header(object, name, is_frob);
+    if (method && method->packed)
+        unpack_method_body(method);
+
+    return method;
+}
+
+/* Look for a method on an object, without decoding its body.  Only the
+ * name, access, flags, native index and source hash may be used from the
+ * result. */
+Method *object_find_method_header(const Obj *object, Ident name,
+                                  IsFrob is_frob)
 {
     Int ind, method;
     Method *meth;
@@ -1379,68 +1626,189 @@ Method *object_find_method_local(const Obj *object, Ident name, IsFrob is_frob)
     return NULL;
 }
 
+/* Mix all of the key into the set index, so that neighbouring objnums and
+ * names do not crowd into neighbouring sets. */
+static uLong method_cache_hash(cObjnum objnum, Ident name, cObjnum after,
+                               IsFrob is_frob)
+{
+    uLong h;
+
+    h = (uLong) objnum * 0x9e3779b1UL + (uLong) name;
+    h = h * 0x85ebca6bUL + (uLong) after;
+    h = h * 0xc2b2ae35UL + (uLong) is_frob;
+    h ^= h >> 15;
+    h *= 0x2c1b3c6dUL;
+    h ^= h >> 13;
+
+    return h & method_cache_mask;
+}
+
+#define METHOD_CACHE_VALID(_e_) \
+    ((_e_)->stamp == cur_stamp && (_e_)->obj_stamp == OBJ_STAMP((_e_)->objnum))
+
+/* Move the entry at way in set to the front of it. */
+static struct method_cache_entry *method_cache_touch(
+                                      struct method_cache_entry *set, Int way)
+{
+    struct method_cache_entry e;
+
+    if (way) {
+        e = set[way];
+        MEMMOVE(&set[1], &set[0], way);
+        set[0] = e;
+    }
+
+    return set;
+}
+
+/* Make the method cache hold size entries, rounded up to whole sets and a
+ * power of two of them, dropping what it held.  size is kept within 1 and
+ * METHOD_CACHE_MAX.  Returns the new size. */
+Int method_cache_resize(Int size)
+{
+    struct method_cache_entry *e;
+    uLong sets, i;
+
+    if (size < 1)
+        size = 1;
+    else if (size > METHOD_CACHE_MAX)
+        size = METHOD_CACHE_MAX;
+
+    if (method_cache) {
+        for (i = 0; i < (method_cache_mask + 1) * METHOD_CACHE_WAYS; i++) {
+            e = &method_cache[i];
+            if (e->stamp != 0)
+                ident_discard(e->name);
+        }
+        efree(method_cache);
+    }
+
+    for (sets = 1; sets * METHOD_CACHE_WAYS < (uLong) size; sets <<= 1);
+    method_cache = EMALLOC(struct method_cache_entry, sets * METHOD_CACHE_WAYS);
+    memset(method_cache, 0,
+           sets * METHOD_CACHE_WAYS * sizeof(struct method_cache_entry));
+    method_cache_mask = sets - 1;
+    method_cache_size = sets * METHOD_CACHE_WAYS;
+
+    return method_cache_size;
+}
+
 static bool method_cache_check(cObjnum objnum, Ident name,
                                cObjnum after, IsFrob is_frob, Method **method)
 {
+    struct method_cache_entry *set, *e;
     Obj *object;
     Int i;
 
-    i = (10 + objnum + (name << 4) + (is_frob << 8) + after) % METHOD_CACHE_SIZE;
-    if (method_cache[i].stamp == cur_stamp && method_cache[i].objnum == objnum &&
-        method_cache[i].name == name && method_cache[i].after == after &&
-        method_cache[i].loc != -1 && method_cache[i].is_frob==is_frob) {
-        method_cache_hits++;
-        if (!method_cache[i].failed) {
-            object = cache_retrieve(method_cache[i].loc);
-            *method = object_find_method_local(object, name, is_frob);
-            return true;
-        } else {
-            *method = NULL;
-            return true;
-        }
-    } else {
+    if (!method_cache)
+        method_cache_resize(method_cache_size);
+
+    /* A retry is a search for methods which are not frob methods. */
+    if (is_frob == FROB_RETRY)
+        is_frob = FROB_NO;
+    set = &method_cache[method_cache_hash(objnum, name, after, is_frob) *
+                        METHOD_CACHE_WAYS];
+    for (i = 0; i < METHOD_CACHE_WAYS; i++) {
+        e = &set[i];
+        if (e->objnum == objnum && e->name == name && e->after == after &&
+            e->is_frob == is_frob && e->stamp == cur_stamp &&
+            e->loc != -1 && e->obj_stamp == OBJ_STAMP(objnum))
+            break;
+    }
+    if (i == METHOD_CACHE_WAYS) {
         method_cache_misses++;
         *method = NULL;
         return false;
     }
+
+    method_cache_hits++;
+    e = method_cache_touch(set, i);
+    if (!e->failed) {
+        object = cache_retrieve(e->loc);
+        *method = object_find_method_local(object, name, is_frob);
+    } else {
+        *method = NULL;
+    }
+    return true;
 }
 
 static void method_cache_set(cObjnum objnum, Ident name, cObjnum after,
                              Long loc, IsFrob is_frob, bool failed)
 {
-    uLong i;
+    struct method_cache_entry *set, *e;
+    Int i;
 
-    i = (uLong)(10 + objnum + (name << 4) + (is_frob << 8) + after) % METHOD_CACHE_SIZE;
-    if (method_cache[i].stamp != 0) {
-      ident_discard(method_cache[i].name);
-      if (method_cache[i].stamp == cur_stamp)
-          method_cache_collisions++;
+    if (!method_cache)
+        method_cache_resize(method_cache_size);
+
+    /* An entry for the same search if there is one, else one no longer
+     * good, else the least recently used. */
+    if (is_frob == FROB_RETRY)
+        is_frob = FROB_NO;
+    set = &method_cache[method_cache_hash(objnum, name, after, is_frob) *
+                        METHOD_CACHE_WAYS];
+    for (i = 0; i < METHOD_CACHE_WAYS; i++) {
+        e = &set[i];
+        if (e->objnum == objnum && e->name == name && e->after == after &&
+            e->is_frob == is_frob && e->stamp != 0)
+            break;
     }
-    method_cache[i].stamp = cur_stamp;
-    method_cache[i].objnum = objnum;
-    method_cache[i].name = ident_dup(name);
-    method_cache[i].after = after;
-    method_cache[i].loc = loc;
-    method_cache[i].is_frob=(is_frob == FROB_RETRY) ? FROB_NO : is_frob;
-    method_cache[i].failed = failed;
+    if (i == METHOD_CACHE_WAYS) {
+        for (i = 0; i < METHOD_CACHE_WAYS - 1; i++) {
+            if (!METHOD_CACHE_VALID(&set[i]))
+                break;
+        }
+        if (METHOD_CACHE_VALID(&set[i]))
+            method_cache_collisions++;
+    }
+
+    e = method_cache_touch(set, i);
+    if (e->stamp != 0)
+        ident_discard(e->name);
+    e->stamp = cur_stamp;
+    e->obj_stamp = OBJ_STAMP(objnum);
+    e->objnum = objnum;
+    e->name = ident_dup(name);
+    e->after = after;
+    e->loc = loc;
+    e->is_frob = is_frob;
+    e->failed = failed;
 
     method_cache_sets++;
 }
 
 cList * method_cache_info() {
-    cList * entry;
+    cList * entry, * histogram;
     cData * d;
-    Int     used_buckets;
+    Int     used_buckets, used, counts[METHOD_CACHE_WAYS + 1];
     uLong   i;
+    Int     j;
+
+    if (!method_cache)
+        method_cache_resize(method_cache_size);
 
+    /* How many sets hold each number of good entries. */
     used_buckets = 0;
-    for (i = 0; i < METHOD_CACHE_SIZE; i++) {
-        if (method_cache[i].stamp == cur_stamp)
-            used_buckets++;
+    memset(counts, 0, sizeof(counts));
+    for (i = 0; i <= method_cache_mask; i++) {
+        used = 0;
+        for (j = 0; j < METHOD_CACHE_WAYS; j++) {
+            if (METHOD_CACHE_VALID(&method_cache[i * METHOD_CACHE_WAYS + j]))
+                used++;
+        }
+        counts[used]++;
+        used_buckets += used;
+    }
+
+    histogram = list_new(METHOD_CACHE_WAYS + 1);
+    d = list_empty_spaces(histogram, METHOD_CACHE_WAYS + 1);
+    for (j = 0; j <= METHOD_CACHE_WAYS; j++) {
+        d[j].type = INTEGER;
+        d[j].u.val = counts[j];
     }
 
-    entry = list_new(8);
-    d = list_empty_spaces(entry, 8);
+    entry = list_new(9);
+    d = list_empty_spaces(entry, 9);
 
     d[0].type = INTEGER;
     d[0].u.val = method_cache_invalidates;
@@ -1457,32 +1825,32 @@ cList * method_cache_info() {
     d[6].type = INTEGER;
     d[6].u.val = used_buckets;
     d[7].type = INTEGER;
-    d[7].u.val = METHOD_CACHE_SIZE;
+    d[7].u.val = method_cache_size;
+    d[8].type = LIST;
+    d[8].u.list = histogram;
 
     return entry;
 }
 
-static void method_cache_invalidate(cObjnum objnum) {
-#ifdef BUILDING_COLDCC
-    method_cache_invalidate_all();
-#else
-    uLong i;
-
-    /*
-     * Invalidate cache entries by decrementing the stamp.
-     * Don't set it to 0, that way method_cache_set() can handle
-     * the ident_discard() properly
-     * Make sure that the stamp is already greater than 0
-     * to avoid false invalidations where objnum == 0, so
-     * it will catch all of the uninitialized entries in the
-     * cache, who will have objnum == 0, but also stamp == 0.
-     */
-    for (i = 0; i < METHOD_CACHE_SIZE; i++) {
-        if ((method_cache[i].objnum == objnum) &&
-            (method_cache[i].stamp > 0)) {
-            method_cache[i].stamp = 1;
-        }
+/* Forget where methods were found through object, after a change to its
+ * methods or parents.  Its stamp is what tells vtables including it; the
+ * method cache entries to drop are those for searches starting at it, or
+ * if it has children, below it too. */
+static void method_cache_invalidate_object(Obj *object) {
+    if (object->children && list_length(object->children) != 0) {
+        OBJ_STAMP(object->objnum)++;
+        method_epoch++;
+        method_cache_invalidate_all();
+    } else {
+        method_cache_invalidate(object->objnum);
     }
+}
+
+static void method_cache_invalidate(cObjnum objnum) {
+    /* Drop the entries for searches starting at objnum, along with those
+     * of any other object sharing its stamp. */
+    OBJ_STAMP(objnum)++;
+    method_epoch++;
 
     method_cache_partials++;
 
@@ -1490,7 +1858,6 @@ static void method_cache_invalidate(cObjnum objnum) {
         write_err("Method cache partially invalidated for obj #%l", objnum);
         log_current_task_stack(false, write_err);
     }
-#endif
 }
 
 static void method_cache_invalidate_all(void) {
@@ -1531,6 +1898,7 @@ static void method_cache_invalidate_all(void) {
     method_cache_sets = 0;
     method_cache_collisions = 0;
     cur_stamp++;
+    method_generation++;
 }
 
 
@@ -1554,22 +1922,26 @@ bool object_rename_method(Obj * object, Ident oname, Ident nname) {
 
 void object_add_method(Obj *object, Ident name, Method *method) {
     Int ind, hval;
+    Method *old;
+    bool same;
 
     cache_dirty_object(object);
 
     if (!object->methods)
         object_alloc_methods(object);
 
+    /* A method replacing one is found wherever that one was, unless it
+       differs in being overridable or a frob method. */
+    old = object_find_method_header(object, name, FROB_ANY);
+    same = old && !((old->m_flags ^ method->m_flags) & MF_NOOVER) &&
+           (old->m_access == MS_FROB) == (method->m_access == MS_FROB);
+
     /* Delete the method if it previous existed, calling this on a
        locked method WILL CAUSE PROBLEMS, make sure you check before
        calling this. */
-    if (object_del_method(object, name, true) != 1) {
+    if (object_del_method(object, name, true) != 1 || !same) {
         /* Invalidate the method cache. */
-        if (object->children && list_length(object->children) != 0) {
-            method_cache_invalidate_all();
-        } else {
-            method_cache_invalidate(object->objnum);
-        }
+        method_cache_invalidate_object(object);
     }
 
     /* If the method table is full, expand it and its corresponding hash
@@ -1644,6 +2016,7 @@ Int object_del_method(Obj *object, Ident name, bool replacing) {
             /* ok, we can discard it. */
             method_discard(object->methods->tab[ind].m);
             object->methods->tab[ind].m = NULL;
+            method_generation++;
 
             /* Remove ind from the hash table thread, and add it to the blanks
              * thread. */
@@ -1653,11 +2026,7 @@ Int object_del_method(Obj *object, Ident name, bool replacing) {
 
             if (replacing == false) {
                 /* Invalidate the method cache. */
-                if (object->children && list_length(object->children) != 0) {
-                    method_cache_invalidate_all();
-                } else {
-                    method_cache_invalidate(object->objnum);
-                }
+                method_cache_invalidate_object(object);
             }
 
             /* Return one, meaning the method was successfully deleted. */
@@ -1680,14 +2049,14 @@ cList *object_list_method(Obj *object, Ident name, Int indent, int fflags)
 Int object_get_method_flags(const Obj * object, Ident name) {
     Method * method;
 
-    method = object_find_method_local(object, name, FROB_ANY);
+    method = object_find_method_header(object, name, FROB_ANY);
     return (method) ? method->m_flags : -1;
 }
 
 Int object_set_method_flags(Obj * object, Ident name, Int flags) {
     Method * method;
 
-    method = object_find_method_local(object, name, FROB_ANY);
+    method = object_find_method_header(object, name, FROB_ANY);
     if (method == NULL)
         return -1;
 
@@ -1695,7 +2064,7 @@ Int object_set_method_flags(Obj * object, Ident name, Int flags) {
 
     if ((!(method->m_flags & MF_NOOVER) && (flags & MF_NOOVER)) ||
         ((method->m_flags & MF_NOOVER) && !(flags & MF_NOOVER))) {
-        method_cache_invalidate_all();
+        method_cache_invalidate_object(object);
     }
 
     method->m_flags = flags;
@@ -1705,14 +2074,14 @@ Int object_set_method_flags(Obj * object, Ident name, Int flags) {
 Int object_get_method_access(const Obj * object, Ident name) {
     Method * method;
 
-    method = object_find_method_local(object, name, FROB_ANY);
+    method = object_find_method_header(object, name, FROB_ANY);
     return (method) ? method->m_access : -1;
 }
 
 Int object_set_method_access(Obj * object, Ident name, Int access) {
     Method * method;
 
-    method = object_find_method_local(object, name, FROB_ANY);
+    method = object_find_method_header(object, name, FROB_ANY);
     if (method == NULL)
         return -1;
     if (method->m_access == access) {
@@ -1723,7 +2092,7 @@ Int object_set_method_access(Obj * object, Ident name, Int access) {
         /*
          * only invalidate when changing access to or from 'frob' access.
          */
-        method_cache_invalidate_all();
+        method_cache_invalidate_object(object);
     }
     cache_dirty_object(object);
 
@@ -1737,6 +2106,11 @@ Method * method_new(void) {
     method->m_flags  = MF_NONE;
     method->m_access = MS_PUBLIC;
     method->native   = -1;
+    method->packed   = NULL;
+    method->threaded = NULL;
+    method->lines    = NULL;
+    method->source_hash = 0;
+    method->call_refs = 0;
 
     /* usually everything else is initialized elsewhere */
     return method;
@@ -1750,10 +2124,23 @@ void method_free(Method *method)
 
     if (method->name != -1)
         ident_discard(method->name);
+    if (method->packed) {
+        /* The body was never decoded, so there is nothing else to free. */
+        buffer_discard(method->packed);
+        efree(method);
+        return;
+    }
     if (method->num_args)
         TFREE(method->argnames, method->num_args);
     if (method->num_vars)
         TFREE(method->varnames, method->num_vars);
+    if (method->threaded) {
+        method_forget_calls(method);
+        optimize_free(method);
+        efree(method->threaded);
+    }
+    if (method->lines)
+        TFREE(method->lines, method->num_lines);
     TFREE(method->opcodes, method->num_opcodes);
     if (method->num_error_lists) {
         /* Discard identifiers held in the method's error lists. */
@@ -1775,6 +2162,8 @@ void method_delete_code_refs(Method *method)
     Int i, j, arg_type, opcode;
     Op_info *info;
 
+    unpack_method_body(method);
+
     for (i = 0; i < method->num_args; i++)
         object_discard_ident(method->object, method->argnames[i]);
     if (method->rest != -1)
@@ -1811,6 +2200,94 @@ void method_delete_code_refs(Method *method)
 
 }
 
+/* Copy a method whose code refers to the string and identifier tables of
+ * from, adding what it uses to object's tables instead.  The copy is not
+ * added to object; see object_add_method(). */
+Method *method_copy(Method *method, const Obj *from, Obj *object)
+{
+    Method *cnew;
+    Error_list *elist;
+    Int i, j, arg_type, opcode;
+    Op_info *info;
+
+    unpack_method_body(method);
+
+    cnew = method_new();
+    cnew->name = NOT_AN_IDENT;
+    cnew->m_flags = method->m_flags;
+    cnew->m_access = method->m_access;
+    cnew->native = method->native;
+    cnew->source_hash = method->source_hash;
+    cnew->refs = 1;
+
+    cnew->num_args = method->num_args;
+    if (cnew->num_args) {
+        cnew->argnames = TMALLOC(Int, cnew->num_args);
+        for (i = 0; i < cnew->num_args; i++)
+            cnew->argnames[i] = object_add_ident(object,
+                    ident_name(object_get_ident(from, method->argnames[i])));
+    }
+    if (method->rest != -1)
+        cnew->rest = object_add_ident(object,
+                ident_name(object_get_ident(from, method->rest)));
+    else
+        cnew->rest = -1;
+
+    cnew->num_vars = method->num_vars;
+    if (cnew->num_vars) {
+        cnew->varnames = TMALLOC(Int, cnew->num_vars);
+        for (i = 0; i < cnew->num_vars; i++)
+            cnew->varnames[i] = object_add_ident(object,
+                    ident_name(object_get_ident(from, method->varnames[i])));
+    }
+
+    cnew->num_error_lists = method->num_error_lists;
+    if (cnew->num_error_lists) {
+        cnew->error_lists = TMALLOC(Error_list, cnew->num_error_lists);
+        for (i = 0; i < cnew->num_error_lists; i++) {
+            elist = &method->error_lists[i];
+            cnew->error_lists[i].num_errors = elist->num_errors;
+            cnew->error_lists[i].error_ids = TMALLOC(Int, elist->num_errors);
+            for (j = 0; j < elist->num_errors; j++)
+                cnew->error_lists[i].error_ids[j] = ident_dup(elist->error_ids[j]);
+        }
+    }
+
+    cnew->num_opcodes = method->num_opcodes;
+    cnew->opcodes = TMALLOC(Long, cnew->num_opcodes);
+    MEMCPY(cnew->opcodes, method->opcodes, cnew->num_opcodes);
+
+    i = 0;
+    while (i < cnew->num_opcodes) {
+        opcode = cnew->opcodes[i];
+
+        /* Use opcode info table for anything else. */
+        info = &op_table[opcode];
+        for (j = 0; j < 2; j++) {
+            arg_type = (j == 0) ? info->arg1 : info->arg2;
+            if (arg_type) {
+                i++;
+                switch (arg_type) {
+
+                  case STRING:
+                    cnew->opcodes[i] = object_add_string(object,
+                            object_get_string(from, method->opcodes[i]));
+                    break;
+
+                  case IDENT:
+                    cnew->opcodes[i] = object_add_ident(object,
+                            ident_name(object_get_ident(from, method->opcodes[i])));
+                    break;
+
+                }
+            }
+        }
+        i++;
+    }
+
+    return cnew;
+}
+
 Method * method_dup(Method * method) {
     method->refs++;
     return method;
@@ -1818,10 +2295,19 @@ Method * method_dup(Method * method) {
 
 void method_discard(Method *method) {
     method->refs--;
-    if (!method->refs) {
+    if (method->refs == method->call_refs && method->object) {
+        /* Only call-site caches hold it now, and they do not keep its
+           object loaded, so it is done with the object.  It cannot run
+           again either, so its own call sites let go of what they hold,
+           which may come back to this method. */
         method_delete_code_refs(method);
-        method_free(method);
+        method->object = NULL;
+        method->refs++;
+        method_forget_calls(method);
+        method->refs--;
     }
+    if (!method->refs)
+        method_free(method);
 }
 
 bool object_del_objname(Obj * object) {
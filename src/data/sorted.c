@@ -0,0 +1,781 @@
+/*
+// Full copyright information is available in the file ../doc/CREDITS
+*/
+
+#include "defs.h"
+
+#include <stddef.h>
+#include "util.h"
+#include "dbpack.h"
+#include "macros.h"
+
+/*
+// A sorted list is a B+tree whose leaves hold the elements in order.  An
+// interior node holds its children and, for each child but the first, a
+// copy of an element no greater than any in that child and no less than
+// any in the child before it, by which a value is looked up.  (The first
+// of these is not looked at.)  Every node also keeps the number of
+// elements below it, so that elements can be found by position as well.
+//
+// Nodes are shared between sorted lists when one is changed while another
+// refers to it, as when an object variable and the stack both hold it: a
+// change copies the root and the nodes on the way down to the element
+// changed, and leaves the rest to both.
+*/
+
+#define NODE_SIZE       64              /* at most NODE_SIZE - 1 entries */
+#define NODE_MIN        (NODE_SIZE / 4) /* and at least this many, but root */
+#define NODE_FILL       (NODE_SIZE * 3 / 4)     /* when built in bulk */
+#define SORTED_DEPTH    16
+
+struct sorted_node {
+    Int refs;
+    Int n;                          /* elements, or children */
+    Int count;                      /* elements below this node */
+    bool leaf;
+    cData el[NODE_SIZE];
+    Sorted_node * child[NODE_SIZE]; /* not allocated for leaves */
+};
+
+/* An in-order walk over the elements, from the root down to a leaf. */
+typedef struct {
+    Int depth;
+    Sorted_node * node[SORTED_DEPTH];
+    Int pos[SORTED_DEPTH];
+} Sorted_iter;
+
+INSTANCE_PROTOTYPES(sorted);
+
+static Sorted_node *node_new(bool leaf) {
+    Sorted_node *node;
+
+    node = emalloc(leaf ? offsetof(Sorted_node, child) : sizeof(Sorted_node));
+    node->refs = 1;
+    node->n = 0;
+    node->count = 0;
+    node->leaf = leaf;
+    return node;
+}
+
+static void node_discard(Sorted_node *node) {
+    Int i;
+
+    if (--node->refs)
+        return;
+    for (i = 0; i < node->n; i++) {
+        data_discard(&node->el[i]);
+        if (!node->leaf)
+            node_discard(node->child[i]);
+    }
+    efree(node);
+}
+
+/* Returns node, or a copy of it if it is shared, to be changed. */
+static Sorted_node *node_prep(Sorted_node *node) {
+    Sorted_node *cnew;
+    Int i;
+
+    if (node->refs == 1)
+        return node;
+
+    cnew = node_new(node->leaf);
+    cnew->n = node->n;
+    cnew->count = node->count;
+    for (i = 0; i < node->n; i++) {
+        data_dup(&cnew->el[i], &node->el[i]);
+        if (!node->leaf) {
+            cnew->child[i] = node->child[i];
+            cnew->child[i]->refs++;
+        }
+    }
+    node->refs--;
+    return cnew;
+}
+
+/*
+// -----------------------------------------------------------------------
+// comparison, by the key of each element if the sorted list is keyed
+// -----------------------------------------------------------------------
+*/
+
+/* Sets value to a copy of the key of elem. */
+static void key_of(cSorted *sorted, const cData *elem, cData *value) {
+    if (!sorted->keyed) {
+        data_dup(value, elem);
+    } else if (elem->type == LIST) {
+        data_dup(value, list_elem(elem->u.list, sorted->key.u.val - 1));
+    } else if (!dict_find(elem->u.dict, &sorted->key, value)) {
+        value->type = INTEGER;
+        value->u.val = 0;
+    }
+}
+
+/* Compares value, a key, with the key of elem.  data_cmp() changes an
+ * integer compared with a float, so it is given copies. */
+static Int key_cmp(cSorted *sorted, const cData *value, const cData *elem) {
+    cData d1 = *value, d2;
+    Int result;
+
+    if (!sorted->keyed || elem->type == LIST) {
+        d2 = sorted->keyed ?
+             *list_elem(elem->u.list, sorted->key.u.val - 1) : *elem;
+        return data_cmp(&d1, &d2);
+    }
+    key_of(sorted, elem, &d2);
+    result = data_cmp(&d1, &d2);
+    data_discard(&d2);
+    return result;
+}
+
+static Int elem_cmp(cSorted *sorted, const cData *e1, const cData *e2) {
+    cData value;
+    Int result;
+
+    if (!sorted->keyed)
+        return key_cmp(sorted, e1, e2);
+    key_of(sorted, e1, &value);
+    result = key_cmp(sorted, &value, e2);
+    data_discard(&value);
+    return result;
+}
+
+/* Returns the number of el[from .. n - 1] less than value, or no greater
+ * than it if upper is set. */
+static Int bound(cSorted *sorted, const cData *value, cData *el,
+                 Int from, Int n, bool upper)
+{
+    Int lo = from, hi = n, mid, result;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        result = key_cmp(sorted, value, &el[mid]);
+        if (result > 0 || (upper && result == 0))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo - from;
+}
+
+/* Returns the child of an interior node where value belongs. */
+static Int child_for(cSorted *sorted, Sorted_node *node, const cData *value,
+                     bool upper)
+{
+    return bound(sorted, value, node->el, 1, node->n, upper);
+}
+
+/*
+// -----------------------------------------------------------------------
+// walking the tree
+// -----------------------------------------------------------------------
+*/
+
+/* Returns the element at pos, and sets up it to walk on from there. */
+static cData *iter_start(Sorted_iter *it, Sorted_node *node, Int pos) {
+    Int i;
+
+    it->depth = 0;
+    if (!node || pos < 0 || pos >= node->count)
+        return NULL;
+    while (!node->leaf) {
+        for (i = 0; pos >= node->child[i]->count; i++)
+            pos -= node->child[i]->count;
+        it->node[it->depth] = node;
+        it->pos[it->depth++] = i;
+        node = node->child[i];
+    }
+    it->node[it->depth] = node;
+    it->pos[it->depth++] = pos;
+    return &node->el[pos];
+}
+
+static cData *iter_next(Sorted_iter *it) {
+    Sorted_node *node;
+    Int d = it->depth - 1;
+
+    if (d < 0)
+        return NULL;
+    if (++it->pos[d] < it->node[d]->n)
+        return &it->node[d]->el[it->pos[d]];
+
+    /* Up to the first node with children left, and down to its next leaf */
+    do {
+        if (--d < 0) {
+            it->depth = 0;
+            return NULL;
+        }
+    } while (it->pos[d] + 1 >= it->node[d]->n);
+    node = it->node[d]->child[++it->pos[d]];
+    while (++d < it->depth) {
+        it->node[d] = node;
+        it->pos[d] = 0;
+        if (!node->leaf)
+            node = node->child[0];
+    }
+    return &it->node[d - 1]->el[0];
+}
+
+/*
+// -----------------------------------------------------------------------
+// building a tree from sorted elements
+// -----------------------------------------------------------------------
+*/
+
+/* Builds a tree of the len elements el, which it takes over, filling the
+ * nodes to NODE_FILL so that there is room to add to them. */
+static Sorted_node *build_tree(cData *el, Int len) {
+    Sorted_node **level, *node;
+    Int i, j, k, m, n, per, extra;
+
+    if (!len)
+        return NULL;
+
+    m = (len + NODE_FILL - 1) / NODE_FILL;
+    level = EMALLOC(Sorted_node *, m);
+    per = len / m;
+    extra = len % m;
+    for (i = k = 0; i < m; i++) {
+        node = node_new(true);
+        node->n = node->count = per + (i < extra);
+        MEMCPY(node->el, el + k, node->n);
+        k += node->n;
+        level[i] = node;
+    }
+
+    /* Each level above takes the one below as evenly as it can, reusing
+     * level[] as it goes, since a node never comes before its children. */
+    while (m > 1) {
+        n = (m + NODE_FILL - 1) / NODE_FILL;
+        per = m / n;
+        extra = m % n;
+        for (i = k = 0; i < n; i++) {
+            node = node_new(false);
+            node->n = per + (i < extra);
+            for (j = 0; j < node->n; j++) {
+                node->child[j] = level[k + j];
+                data_dup(&node->el[j], &level[k + j]->el[0]);
+                node->count += level[k + j]->count;
+            }
+            k += node->n;
+            level[i] = node;
+        }
+        m = n;
+    }
+
+    node = level[0];
+    efree(level);
+    return node;
+}
+
+/* A stable merge sort, which does nothing more for a run which is in
+ * order already than to compare its halves. */
+static void sort_elems(cSorted *sorted, cData *el, cData *tmp, Int len) {
+    Int half = len / 2, i, j, k;
+
+    if (len < 2)
+        return;
+    sort_elems(sorted, el, tmp, half);
+    sort_elems(sorted, el + half, tmp, len - half);
+    if (elem_cmp(sorted, &el[half - 1], &el[half]) <= 0)
+        return;
+
+    MEMCPY(tmp, el, half);
+    i = k = 0;
+    j = half;
+    while (i < half && j < len) {
+        if (elem_cmp(sorted, &el[j], &tmp[i]) < 0)
+            el[k++] = el[j++];
+        else
+            el[k++] = tmp[i++];
+    }
+    while (i < half)
+        el[k++] = tmp[i++];
+}
+
+/*
+// -----------------------------------------------------------------------
+// sorted lists
+// -----------------------------------------------------------------------
+*/
+
+cSorted *sorted_new(const cData *key) {
+    cSorted *cnew = EMALLOC(cSorted, 1);
+
+    cnew->refs = 1;
+    cnew->keyed = (key != NULL);
+    if (key)
+        data_dup(&cnew->key, key);
+    cnew->hash = 0;
+    cnew->root = NULL;
+    return cnew;
+}
+
+/* The elements of list must have been checked with sorted_valid_elem(). */
+cSorted *sorted_from_list(cList *list, const cData *key) {
+    cSorted *cnew = sorted_new(key);
+    cData *el, *tmp, *d;
+    Int i = 0, len = list_length(list);
+
+    if (!len)
+        return cnew;
+
+    el = EMALLOC(cData, len);
+    for (d = list_first(list); d; d = list_next(list, d))
+        data_dup(&el[i++], d);
+    tmp = EMALLOC(cData, len / 2);
+    sort_elems(cnew, el, tmp, len);
+    efree(tmp);
+
+    cnew->root = build_tree(el, len);
+    efree(el);
+    return cnew;
+}
+
+cSorted *sorted_dup(cSorted *sorted) {
+    sorted->refs++;
+    return sorted;
+}
+
+void sorted_discard(cSorted *sorted) {
+    if (--sorted->refs)
+        return;
+    if (sorted->keyed)
+        data_discard(&sorted->key);
+    if (sorted->root)
+        node_discard(sorted->root);
+    efree(sorted);
+}
+
+/* Returns sorted, or a copy of it if it is shared, with its root ready to
+ * be changed. */
+static cSorted *sorted_prep(cSorted *sorted) {
+    cSorted *cnew;
+
+    if (sorted->refs > 1) {
+        cnew = sorted_new(sorted->keyed ? &sorted->key : NULL);
+        cnew->root = sorted->root;
+        if (cnew->root)
+            cnew->root->refs++;
+        sorted->refs--;
+        sorted = cnew;
+    }
+    if (sorted->root)
+        sorted->root = node_prep(sorted->root);
+    sorted->hash = 0;
+    return sorted;
+}
+
+Int sorted_length(const cSorted *sorted) {
+    return sorted->root ? sorted->root->count : 0;
+}
+
+/* Effects: Returns true if elem can be kept in a sorted list keyed by key,
+ *          which it can if key is NULL, or if elem is a list with an
+ *          element at index key or a dictionary with key, as
+ *          $list.sorted_insert() wants it. */
+bool sorted_valid_elem(const cData *key, const cData *elem) {
+    if (!key)
+        return true;
+    if (elem->type == LIST)
+        return (key->type == INTEGER && key->u.val >= 1 &&
+                key->u.val <= list_length(elem->u.list));
+    if (elem->type == DICT)
+        return dict_contains(elem->u.dict, (cData *) key);
+    return false;
+}
+
+/* Splits a full node, and returns the new node with the upper half. */
+static Sorted_node *node_split(Sorted_node *node) {
+    Sorted_node *right = node_new(node->leaf);
+    Int i, half = node->n / 2;
+
+    right->n = node->n - half;
+    MEMCPY(right->el, node->el + half, right->n);
+    if (node->leaf) {
+        right->count = right->n;
+    } else {
+        MEMCPY(right->child, node->child + half, right->n);
+        for (i = 0; i < right->n; i++)
+            right->count += right->child[i]->count;
+    }
+    node->n = half;
+    node->count -= right->count;
+    return right;
+}
+
+/* Adds elem after any elements with the same key as value, and returns the
+ * node split off from node if it filled up, or NULL. */
+static Sorted_node *node_insert(cSorted *sorted, Sorted_node *node,
+                                const cData *value, const cData *elem)
+{
+    Sorted_node *split;
+    Int i;
+
+    node->count++;
+    if (node->leaf) {
+        i = bound(sorted, value, node->el, 0, node->n, true);
+        MEMMOVE(node->el + i + 1, node->el + i, node->n - i);
+        data_dup(&node->el[i], elem);
+        node->n++;
+    } else {
+        i = child_for(sorted, node, value, true);
+        node->child[i] = node_prep(node->child[i]);
+        split = node_insert(sorted, node->child[i], value, elem);
+        if (!split)
+            return NULL;
+        i++;
+        MEMMOVE(node->el + i + 1, node->el + i, node->n - i);
+        MEMMOVE(node->child + i + 1, node->child + i, node->n - i);
+        data_dup(&node->el[i], &split->el[0]);
+        node->child[i] = split;
+        node->n++;
+    }
+
+    return (node->n == NODE_SIZE) ? node_split(node) : NULL;
+}
+
+/* elem must have been checked with sorted_valid_elem(). */
+cSorted *sorted_insert(cSorted *sorted, const cData *elem) {
+    Sorted_node *split, *root;
+    cData value;
+
+    sorted = sorted_prep(sorted);
+    if (!sorted->root)
+        sorted->root = node_new(true);
+
+    key_of(sorted, elem, &value);
+    split = node_insert(sorted, sorted->root, &value, elem);
+    data_discard(&value);
+
+    if (split) {
+        root = node_new(false);
+        root->n = 2;
+        root->count = sorted->root->count + split->count;
+        data_dup(&root->el[0], &sorted->root->el[0]);
+        data_dup(&root->el[1], &split->el[0]);
+        root->child[0] = sorted->root;
+        root->child[1] = split;
+        sorted->root = root;
+    }
+    return sorted;
+}
+
+/* Evens out node->child[i], which has too few entries, with the child next
+ * to it, either by moving some of the other's entries over or, if there
+ * is room, by taking them all. */
+static void node_rebalance(Sorted_node *node, Int i) {
+    Sorted_node *left, *right;
+    Int l = (i > 0) ? i - 1 : i,
+        r = l + 1,
+        j, k, moved;
+
+    left = node->child[l] = node_prep(node->child[l]);
+    right = node->child[r] = node_prep(node->child[r]);
+
+    if (left->n + right->n < NODE_SIZE) {
+        /* The element for the right child is kept as its entry in the left,
+         * unless these are leaves, where the elements themselves go. */
+        if (left->leaf) {
+            data_discard(&node->el[r]);
+            MEMCPY(left->el + left->n, right->el, right->n);
+        } else {
+            left->el[left->n] = node->el[r];
+            data_discard(&right->el[0]);
+            MEMCPY(left->el + left->n + 1, right->el + 1, right->n - 1);
+            MEMCPY(left->child + left->n, right->child, right->n);
+        }
+        left->n += right->n;
+        left->count += right->count;
+        efree(right);
+        MEMMOVE(node->el + r, node->el + r + 1, node->n - r - 1);
+        MEMMOVE(node->child + r, node->child + r + 1, node->n - r - 1);
+        node->n--;
+        return;
+    }
+
+    k = (left->n + right->n) / 2;
+    if (left->n < k) {
+        /* Move the first entries of right to the end of left */
+        k -= left->n;
+        if (left->leaf) {
+            MEMCPY(left->el + left->n, right->el, k);
+            moved = k;
+        } else {
+            left->el[left->n] = node->el[r];
+            data_discard(&right->el[0]);
+            MEMCPY(left->el + left->n + 1, right->el + 1, k - 1);
+            MEMCPY(left->child + left->n, right->child, k);
+            for (moved = j = 0; j < k; j++)
+                moved += right->child[j]->count;
+            MEMMOVE(right->child, right->child + k, right->n - k);
+            data_dup(&node->el[r], &right->el[k]);
+        }
+        MEMMOVE(right->el, right->el + k, right->n - k);
+        left->n += k;
+        right->n -= k;
+    } else {
+        /* Move the last entries of left to the front of right */
+        k = left->n - k;
+        MEMMOVE(right->el + k, right->el, right->n);
+        MEMCPY(right->el, left->el + left->n - k, k);
+        if (left->leaf) {
+            moved = k;
+        } else {
+            data_discard(&right->el[k]);
+            right->el[k] = node->el[r];
+            MEMMOVE(right->child + k, right->child, right->n);
+            MEMCPY(right->child, left->child + left->n - k, k);
+            for (moved = j = 0; j < k; j++)
+                moved += right->child[j]->count;
+            data_dup(&node->el[r], &right->el[0]);
+        }
+        left->n -= k;
+        right->n += k;
+        moved = -moved;
+    }
+    left->count += moved;
+    right->count -= moved;
+    if (left->leaf) {
+        data_discard(&node->el[r]);
+        data_dup(&node->el[r], &right->el[0]);
+    }
+}
+
+static void node_delete(Sorted_node *node, Int pos) {
+    Int i;
+
+    node->count--;
+    if (node->leaf) {
+        data_discard(&node->el[pos]);
+        MEMMOVE(node->el + pos, node->el + pos + 1, node->n - pos - 1);
+        node->n--;
+        return;
+    }
+
+    for (i = 0; pos >= node->child[i]->count; i++)
+        pos -= node->child[i]->count;
+    node->child[i] = node_prep(node->child[i]);
+    node_delete(node->child[i], pos);
+    if (node->child[i]->n < NODE_MIN)
+        node_rebalance(node, i);
+}
+
+/* Error-checking on pos is the job of the calling function. */
+cSorted *sorted_delete(cSorted *sorted, Int pos) {
+    Sorted_node *root;
+
+    sorted = sorted_prep(sorted);
+    node_delete(sorted->root, pos);
+
+    root = sorted->root;
+    if (!root->leaf && root->n == 1) {
+        sorted->root = root->child[0];
+        data_discard(&root->el[0]);
+        efree(root);
+    } else if (root->n == 0) {
+        node_discard(root);
+        sorted->root = NULL;
+    }
+    return sorted;
+}
+
+/* Effects: Returns the number of elements whose keys are less than value,
+ *          or no greater than value if upper is set. */
+Int sorted_rank(cSorted *sorted, const cData *value, bool upper) {
+    Sorted_node *node = sorted->root;
+    Int i, j, rank = 0;
+
+    if (!node)
+        return 0;
+    while (!node->leaf) {
+        i = child_for(sorted, node, value, upper);
+        for (j = 0; j < i; j++)
+            rank += node->child[j]->count;
+        node = node->child[i];
+    }
+    return rank + bound(sorted, value, node->el, 0, node->n, upper);
+}
+
+/* Effects: Returns the position of an element equal to elem, or -1.
+ *          elem must pass sorted_valid_elem(), which the caller checks. */
+Int sorted_search(cSorted *sorted, const cData *elem) {
+    Sorted_iter it;
+    cData value, d1, d2, *d;
+    Int pos;
+
+    key_of(sorted, elem, &value);
+    pos = sorted_rank(sorted, &value, false);
+    for (d = iter_start(&it, sorted->root, pos); d; d = iter_next(&it)) {
+        if (key_cmp(sorted, &value, d) != 0)
+            break;
+        d1 = *elem;
+        d2 = *d;
+        if (data_cmp(&d1, &d2) == 0) {
+            data_discard(&value);
+            return pos;
+        }
+        pos++;
+    }
+    data_discard(&value);
+    return -1;
+}
+
+/* Error-checking on pos is the job of the calling function. */
+cData *sorted_elem(cSorted *sorted, Int pos) {
+    Sorted_iter it;
+
+    return iter_start(&it, sorted->root, pos);
+}
+
+/* Error-checking on start and len is the job of the calling function. */
+cList *sorted_sublist(cSorted *sorted, Int start, Int len) {
+    Sorted_iter it;
+    cList *list = list_new(len);
+    cData *d;
+
+    for (d = iter_start(&it, sorted->root, start); d && len--;
+         d = iter_next(&it))
+        list = list_add(list, d);
+    return list;
+}
+
+cList *sorted_to_list(cSorted *sorted) {
+    return sorted_sublist(sorted, 0, sorted_length(sorted));
+}
+
+uLong sorted_hash(cSorted *sorted) {
+    Sorted_iter it;
+    cData *d;
+    uLong hash;
+
+    if (!sorted->hash) {
+        hash = sorted_length(sorted);
+        if (sorted->keyed)
+            hash = hash_combine(hash, data_hash(&sorted->key));
+        for (d = iter_start(&it, sorted->root, 0); d; d = iter_next(&it))
+            hash = hash_combine(hash, data_hash(d));
+        sorted->hash = hash ? hash : 1;
+    }
+    return sorted->hash;
+}
+
+/*
+// -----------------------------------------------------------------------
+// instance hooks
+// -----------------------------------------------------------------------
+*/
+
+cBuf *pack_sorted(cBuf *buf, const cData *d) {
+    cSorted *sorted = SORTED(d);
+    Sorted_iter it;
+    cData *e;
+
+    buf = write_long(buf, sorted->keyed);
+    if (sorted->keyed)
+        buf = pack_data(buf, &sorted->key);
+    buf = write_long(buf, sorted_length(sorted));
+    for (e = iter_start(&it, sorted->root, 0); e; e = iter_next(&it))
+        buf = pack_data(buf, e);
+    return buf;
+}
+
+void unpack_sorted(const cBuf *buf, Long *buf_pos, cData *d) {
+    cSorted *sorted;
+    cData key, *el;
+    Int i, len;
+
+    if (read_long(buf, buf_pos)) {
+        unpack_data(buf, buf_pos, &key);
+        sorted = sorted_new(&key);
+        data_discard(&key);
+    } else {
+        sorted = sorted_new(NULL);
+    }
+
+    len = read_long(buf, buf_pos);
+    if (len) {
+        el = EMALLOC(cData, len);
+        for (i = 0; i < len; i++)
+            unpack_data(buf, buf_pos, &el[i]);
+        sorted->root = build_tree(el, len);
+        efree(el);
+    }
+    d->u.instance = sorted;
+}
+
+int size_sorted(const cData *d, bool memory_size) {
+    cSorted *sorted = SORTED(d);
+    Sorted_iter it;
+    cData *e;
+    Int size = 0;
+
+    size += size_long(sorted->keyed, memory_size);
+    if (sorted->keyed)
+        size += size_data(&sorted->key, memory_size);
+    size += size_long(sorted_length(sorted), memory_size);
+    for (e = iter_start(&it, sorted->root, 0); e; e = iter_next(&it))
+        size += size_data(e, memory_size);
+    return size;
+}
+
+int compare_sorted(cData *d1, cData *d2) {
+    cSorted *s1 = SORTED(d1),
+            *s2 = SORTED(d2);
+    Sorted_iter it1, it2;
+    cData *e1, *e2, c1, c2;
+
+    if (s1 == s2)
+        return 0;
+    if (s1->keyed != s2->keyed ||
+        sorted_length(s1) != sorted_length(s2))
+        return 1;
+    if (s1->keyed) {
+        c1 = s1->key;
+        c2 = s2->key;
+        if (data_cmp(&c1, &c2) != 0)
+            return 1;
+    }
+
+    e1 = iter_start(&it1, s1->root, 0);
+    e2 = iter_start(&it2, s2->root, 0);
+    for (; e1; e1 = iter_next(&it1), e2 = iter_next(&it2)) {
+        c1 = *e1;
+        c2 = *e2;
+        if (data_cmp(&c1, &c2) != 0)
+            return 1;
+    }
+    return 0;
+}
+
+int hash_sorted(const cData *d) {
+    return sorted_hash(SORTED(d));
+}
+
+void dup_sorted(cData *dest, const cData *source) {
+    dest->u.instance = sorted_dup(SORTED(source));
+}
+
+void discard_sorted(cData *d) {
+    sorted_discard(SORTED(d));
+}
+
+/* #{1, 2, 3}, or #{key; elem, ...} if keyed */
+cStr *string_sorted(cStr *str, const cData *data, int flags) {
+    cSorted *sorted = SORTED(data);
+    Sorted_iter it;
+    cData *e;
+    bool first = true;
+
+    str = string_add_chars(str, "#{", 2);
+    if (sorted->keyed) {
+        str = data_add_literal_to_str(str, &sorted->key, flags);
+        str = string_add_chars(str, "; ", 2);
+    }
+    for (e = iter_start(&it, sorted->root, 0); e; e = iter_next(&it)) {
+        if (!first)
+            str = string_add_chars(str, ", ", 2);
+        first = false;
+        str = data_add_literal_to_str(str, e, flags);
+    }
+    return string_addc(str, '}');
+}
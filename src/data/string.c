@@ -14,6 +14,9 @@
 /* Note that we number string elements [0..(len - 1)] internally, while the
  * user sees string elements as numbered [1..len]. */
 
+/* Shorter strings are cheaper to copy than to concatenate lazily. */
+#define CONCAT_MIN_LENGTH 256
+
 cStr *string_new(Int size_needed) {
     cStr *cnew;
     Int size;
@@ -25,7 +28,10 @@ cStr *string_new(Int size_needed) {
     cnew->len = 0;
     cnew->size = size;
     cnew->refs = 1;
+    cnew->hash = 0;
     cnew->reg = NULL;
+    cnew->left = cnew->right = NULL;
+    cnew->s = cnew->chars;
     *cnew->s = 0;
     return cnew;
 }
@@ -56,7 +62,7 @@ cStr *string_dup(cStr *str) {
 cBuf *string_pack(cBuf *buf, const cStr *str) {
     if (str) {
         buf = write_long(buf, str->len);
-        buf = buffer_append_uchars_single_ref(buf, (unsigned char *)(str->s + str->start), str->len);
+        buf = buffer_append_uchars_single_ref(buf, (unsigned char *) string_chars(str), str->len);
     } else {
         buf = write_long(buf, -1);
     }
@@ -105,17 +111,70 @@ Int string_packed_size(const cStr *str, bool memory_size) {
 }
 
 Int string_cmp(const cStr *str1, const cStr *str2) {
-    return strcmp(str1->s + str1->start, str2->s + str2->start);
+    return strcmp(string_chars(str1), string_chars(str2));
 }
 
 cStr *string_add(cStr *str1, const cStr *str2) {
+    const char *s2 = string_chars(str2);
+
     str1 = string_prep(str1, str1->start, str1->len + str2->len);
-    memcpy(str1->s + str1->start + str1->len - str2->len,
-           str2->s + str2->start, str2->len);
+    memcpy(str1->s + str1->start + str1->len - str2->len, s2, str2->len);
     str1->s[str1->start + str1->len] = 0;
     return str1;
 }
 
+/*
+// string_add() for the interpreter, where str1 is often held by a variable
+// as well as the stack, as in "str = str + x + y", and would be copied for
+// every piece added.  If str1 is long and shared, or is already such a
+// concatenation, return a cStr which refers to both halves instead, whose
+// chars are copied together by string_flatten() when they are wanted.
+//
+// Only the left half is ever a concatenation, so that string_flatten() and
+// string_discard() can follow a long chain of them without recursing.
+*/
+cStr *string_concat(cStr *str1, cStr *str2) {
+    cStr *cnew;
+
+    if (!str1->left && (str1->refs == 1 || str1->len < CONCAT_MIN_LENGTH))
+        return string_add(str1, str2);
+
+    cnew = (cStr *) emalloc(sizeof(cStr));
+    cnew->start = 0;
+    cnew->len = str1->len + str2->len;
+    cnew->size = 0;
+    cnew->refs = 1;
+    cnew->hash = 0;
+    cnew->reg = NULL;
+    cnew->left = str1;
+    cnew->right = string_dup(string_flat(str2));
+    cnew->s = NULL;
+    return cnew;
+}
+
+/* Copy the chars of a concatenation together, in place, as its other
+ * holders still refer to it. */
+cStr *string_flatten(cStr *str) {
+    char *chars, *end;
+    cStr *node;
+
+    chars = emalloc(str->len + 1);
+    end = chars + str->len;
+    *end = 0;
+    for (node = str; node->left; node = node->left) {
+        end -= node->right->len;
+        memcpy(end, string_chars(node->right), node->right->len);
+    }
+    memcpy(chars, string_chars(node), node->len);
+
+    string_discard(str->left);
+    string_discard(str->right);
+    str->left = str->right = NULL;
+    str->s = chars;
+    str->size = str->len + 1;
+    return str;
+}
+
 /* calling this with len == 0 can be a problem */
 cStr *string_add_chars(cStr *str, const char *s, Int len) {
     str = string_prep(str, str->start, str->len + len);
@@ -186,15 +245,38 @@ cStr * string_lowercase(cStr *str) {
  * it will be placed in regexp_error, and the returned regexp will be NULL. */
 regexp *string_regexp(cStr *str) {
     if (!str->reg)
-        str->reg = gen_regcomp(str->s + str->start);
+        str->reg = gen_regcomp(string_chars(str));
     return str->reg;
 }
 
+/* Hash str as strccmp() compares it, ignoring case and stopping at a NUL. */
+uLong string_hash(cStr *str) {
+    const char *s, *nul;
+
+    if (!str->hash) {
+        s = string_chars(str);
+        nul = memchr(s, '\0', str->len);
+        str->hash = hash_chars(s, nul ? nul - s : str->len, true);
+        if (!str->hash)
+            str->hash = 1;
+    }
+    return str->hash;
+}
+
 void string_discard(cStr *str) {
-    if (!--str->refs) {
+    cStr *left;
+
+    /* Follow a chain of concatenations down its left side. */
+    while (str && !--str->refs) {
         if (str->reg)
             efree(str->reg);
+        if (str->right)
+            string_discard(str->right);
+        if (str->s != str->chars)
+            efree(str->s);
+        left = str->left;
         efree(str);
+        str = left;
     }
 }
 
@@ -391,10 +473,14 @@ cStr * string_prep(cStr *str, Int start, Int len) {
     bool need_to_move, need_to_resize;
     Int size;
 
+    str = string_flat(str);
+
     /* Figure out if we need to resize the string or move its contents.  Moving
-     * contents takes precedence. */
+     * contents takes precedence.  Chars kept apart from the cStr are moved
+     * rather than resized. */
     need_to_resize = str->size <= len + start;
-    need_to_move = (str->refs > 1) || (need_to_resize && start > 0);
+    need_to_move = (str->refs > 1) ||
+                   (need_to_resize && (start > 0 || str->s != str->chars));
 
 
     if (need_to_move) {
@@ -410,14 +496,17 @@ cStr * string_prep(cStr *str, Int start, Int len) {
         str->len = len;
         size = len + 1; /* plus one for NULL */
         str = (cStr *)erealloc(str, sizeof(cStr)+(size * sizeof(char)));
+        str->s = str->chars;
         str->s[start+len] = '\0';
         str->size = size;
+        str->hash = 0;
         return str;
     } else {
         if (str->reg) {
             efree(str->reg);
             str->reg = NULL;
         }
+        str->hash = 0;
         str->start = start;
         str->len = len;
         str->s[start+len] = '\0';
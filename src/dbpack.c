@@ -94,7 +94,7 @@ Long read_long(const cBuf *buf, Long *buf_pos)
     bit_shift = 4;
     num_bytes >>= 5;
     while (num_bytes) {
-        n += ((unsigned)buf->s[(*buf_pos)++] & 255) << bit_shift;
+        n += (uLong)((unsigned)buf->s[(*buf_pos)++] & 255) << bit_shift;
         bit_shift += 8;
         num_bytes--;
     }
@@ -103,13 +103,59 @@ Long read_long(const cBuf *buf, Long *buf_pos)
     return (Long)n;
 }
 
+/* Read count numbers written by write_long() into dest.  This is the same
+ * as calling read_long() count times, but keeps the position in a local
+ * and decodes each number with one switch on its length, instead of a
+ * loop, which matters for the long runs in method opcodes. */
+void read_longs(const cBuf *buf, Long *buf_pos, Long *dest, Int count)
+{
+    const unsigned char *s = &buf->s[*buf_pos];
+    const unsigned char *start = s;
+    unsigned c;
+    uLong n;
+    Int   i, bit_shift;
+
+    while (count--) {
+        c = *s++;
+        n = c & 15;
+        switch (c >> 5) {
+          case 0:
+            break;
+          case 1:
+            n |= (uLong)s[0] << 4;
+            s += 1;
+            break;
+          case 2:
+            n |= ((uLong)s[0] << 4) | ((uLong)s[1] << 12);
+            s += 2;
+            break;
+          case 3:
+            n |= ((uLong)s[0] << 4) | ((uLong)s[1] << 12) |
+                 ((uLong)s[2] << 20);
+            s += 3;
+            break;
+          default:
+            /* Only large numbers get here, so don't bother unrolling. */
+            for (i = c >> 5, bit_shift = 4; i; i--, bit_shift += 8)
+                n |= (uLong)*s++ << bit_shift;
+            break;
+        }
+        if (c & 16)
+            n ^= (uLong)(-1);
+        *dest++ = (Long)n;
+    }
+
+    *buf_pos += s - start;
+}
+
+/* The packed size of n, including the byte holding its low bits. */
 static Int size_long_internal(Long n)
 {
     uLong i = (uLong)n;
     Int num_bytes;
 
     i >>= 4;
-    num_bytes = 0;
+    num_bytes = 1;
     while (i) {
         num_bytes++;
         i >>= 8;
@@ -244,19 +290,16 @@ static Int size_list(cList *list, bool memory_size)
     return size;
 }
 
+/* Only the keys and values are written; the hash table is built again when
+ * the dict is unpacked.  Dicts of over 64 keys once carried their table too,
+ * and still carry its size, now 0, so that the layout stays the same. */
 static cBuf * pack_dict(cBuf *buf, cDict *dict)
 {
-    Int i;
-
+    dict_compact(dict);
     buf = pack_list(buf, dict->keys);
     buf = pack_list(buf, dict->values);
-    if (dict->keys->len > 64) {
-        buf = write_long(buf, dict->hashtab_size);
-        for (i = 0; i < dict->hashtab_size; i++) {
-            buf = write_long(buf, dict->links[i]);
-            buf = write_long(buf, dict->hashtab[i]);
-        }
-    }
+    if (list_length(dict->keys) > 64)
+        buf = write_long(buf, 0);
     return buf;
 }
 
@@ -264,50 +307,37 @@ static cDict *unpack_dict(const cBuf *buf, Long *buf_pos)
 {
     cDict *dict;
     cList *keys, *values;
-    Int i;
+    Long i, size;
 
     keys = unpack_list(buf, buf_pos);
     values = unpack_list(buf, buf_pos);
-    if (keys->len <= 64) {
-        dict = dict_new(keys, values);
-        list_discard(keys);
-        list_discard(values);
-        return dict;
-    } else {
-        dict = EMALLOC(cDict, 1);
-        dict->keys = keys;
-        dict->values = values;
-        dict->hashtab_size = read_long(buf, buf_pos);
-        dict->links = EMALLOC(Int, dict->hashtab_size);
-        dict->hashtab = EMALLOC(Int, dict->hashtab_size);
-        for (i = 0; i < dict->hashtab_size; i++) {
-            dict->links[i] = read_long(buf, buf_pos);
-            dict->hashtab[i] = read_long(buf, buf_pos);
-        }
-        dict->refs = 1;
-        return dict;
+    if (list_length(keys) > 64) {
+        /* Skip the chain links and hash table of an older database. */
+        size = read_long(buf, buf_pos);
+        for (i = 0; i < size * 2; i++)
+            read_long(buf, buf_pos);
     }
+    dict = dict_new(keys, values);
+    list_discard(keys);
+    list_discard(values);
+    return dict;
 }
 
 static Int size_dict(cDict *dict, bool memory_size)
 {
-    Int size = 0, i;
+    Int size = 0;
 
+    dict_compact(dict);
     if (memory_size) {
         size += sizeof(cDict);
-        size += (sizeof(Int) * 2) * dict->hashtab_size;
+        size += sizeof(struct dict_slot) * dict->hashtab_size;
     }
 
     size += size_list(dict->keys, memory_size);
     size += size_list(dict->values, memory_size);
 
-    if (dict->keys->len > 64 && !memory_size) {
-        size += size_long(dict->hashtab_size, false);
-        for (i = 0; i < dict->hashtab_size; i++) {
-            size += size_long(dict->links[i], false);
-            size += size_long(dict->hashtab[i], false);
-        }
-    }
+    if (list_length(dict->keys) > 64 && !memory_size)
+        size += size_long(0, false);
     return size;
 }
 
@@ -582,6 +612,13 @@ static cBuf * pack_method(cBuf *buf, Method *method)
     buf = write_long(buf, method->m_access);
     buf = write_long(buf, method->m_flags);
     buf = write_long(buf, method->native);
+    buf = write_long(buf, (Long) method->source_hash);
+
+    /* A method that was never used since it was read is written back
+     * exactly as it was read. */
+    if (method->packed)
+        return buffer_append_uchars_single_ref(buf,
+                   &method->packed->s[method->packed_pos], method->packed_len);
 
     buf = write_long(buf, method->num_args);
     for (i = 0; i < method->num_args; i++) {
@@ -607,24 +644,48 @@ static cBuf * pack_method(cBuf *buf, Method *method)
     return buf;
 }
 
-static Method *unpack_method(const cBuf *buf, Long *buf_pos)
+/* Skip a long without decoding it; the byte count is in the header byte. */
+#define skip_long(_buf_, _buf_pos_) \
+    ((*(_buf_pos_)) += 1 + (((unsigned)(_buf_)->s[*(_buf_pos_)] & 255) >> 5))
+
+static void skip_ident(const cBuf *buf, Long *buf_pos)
 {
-    Int     i, j, n;
-    Method *method;
-    Int     name;
+    Int len;
 
-    /* Read in the name.  If this is -1, it was a marker for a blank entry. */
-    name = read_ident(buf, buf_pos);
-    if (name == NOT_AN_IDENT)
-        return NULL;
+    len = read_long(buf, buf_pos);
+    if (len != NOT_AN_IDENT)
+        (*buf_pos) += len;
+}
 
-    method = EMALLOC(Method, 1);
+/* Step over everything in a packed method following its header. */
+static void skip_method_body(const cBuf *buf, Long *buf_pos)
+{
+    Int i, j, n, m;
+
+    n = read_long(buf, buf_pos);
+    for (i = 0; i < n; i++)
+        skip_long(buf, buf_pos);
+    skip_long(buf, buf_pos);
+
+    n = read_long(buf, buf_pos);
+    for (i = 0; i < n; i++)
+        skip_long(buf, buf_pos);
+
+    n = read_long(buf, buf_pos);
+    for (i = 0; i < n; i++)
+        skip_long(buf, buf_pos);
+
+    n = read_long(buf, buf_pos);
+    for (i = 0; i < n; i++) {
+        m = read_long(buf, buf_pos);
+        for (j = 0; j < m; j++)
+            skip_ident(buf, buf_pos);
+    }
+}
 
-    method->name = name;
-    method->m_access = read_long(buf, buf_pos);
-    method->m_flags = read_long(buf, buf_pos);
-    method->native = read_long(buf, buf_pos);
-    method->refs = 1;
+static void read_method_body(const cBuf *buf, Long *buf_pos, Method *method)
+{
+    Int i, j, n;
 
     method->num_args = read_long(buf, buf_pos);
     if (method->num_args) {
@@ -645,8 +706,7 @@ static Method *unpack_method(const cBuf *buf, Long *buf_pos)
 
     method->num_opcodes = read_long(buf, buf_pos);
     method->opcodes = TMALLOC(Long, method->num_opcodes);
-    for (i = 0; i < method->num_opcodes; i++)
-        method->opcodes[i] = read_long(buf, buf_pos);
+    read_longs(buf, buf_pos, method->opcodes, method->num_opcodes);
 
     method->num_error_lists = read_long(buf, buf_pos);
     if (method->num_error_lists) {
@@ -659,16 +719,70 @@ static Method *unpack_method(const cBuf *buf, Long *buf_pos)
                 method->error_lists[i].error_ids[j] = read_ident(buf, buf_pos);
         }
     }
+}
+
+/* Only the method header is decoded here.  The body is stepped over and
+ * its position remembered; unpack_methods() attaches the packed buffer. */
+static Method *unpack_method(const cBuf *buf, Long *buf_pos, bool hashed)
+{
+    Method *method;
+    Int     name;
+
+    /* Read in the name.  If this is -1, it was a marker for a blank entry. */
+    name = read_ident(buf, buf_pos);
+    if (name == NOT_AN_IDENT)
+        return NULL;
+
+    method = EMALLOC(Method, 1);
+
+    method->name = name;
+    method->m_access = read_long(buf, buf_pos);
+    method->m_flags = read_long(buf, buf_pos);
+    method->native = read_long(buf, buf_pos);
+    method->source_hash = hashed ? (uLong) read_long(buf, buf_pos) : 0;
+    method->refs = 1;
+    method->call_refs = 0;
+
+    method->num_args = 0;
+    method->rest = -1;
+    method->num_vars = 0;
+    method->num_opcodes = 0;
+    method->opcodes = NULL;
+    method->num_error_lists = 0;
+
+    method->threaded = NULL;
+    method->lines = NULL;
+    method->packed = NULL;
+    method->packed_pos = *buf_pos;
+    skip_method_body(buf, buf_pos);
+    method->packed_len = *buf_pos - method->packed_pos;
 
     return method;
 }
 
+/* Decode the rest of a method which is still in its packed form. */
+void unpack_method_body(Method *method)
+{
+    cBuf *packed = method->packed;
+    Long  buf_pos;
+
+    if (!packed)
+        return;
+
+    buf_pos = method->packed_pos;
+    method->packed = NULL;
+    read_method_body(packed, &buf_pos, method);
+    buffer_discard(packed);
+}
+
 static Int size_method(Method *method, bool memory_size)
 {
     Int size = 0, i, j;
 
     if (memory_size) {
         size += sizeof(Method);
+        if (method->packed)
+            return size + method->packed_len;
         size += sizeof(Object_ident) * method->num_args;
         size += sizeof(Object_ident) * method->num_vars;
         size += sizeof(Long) * method->num_opcodes;
@@ -685,6 +799,10 @@ static Int size_method(Method *method, bool memory_size)
     size += size_long(method->native, false);
     size += size_long(method->m_access, false);
     size += size_long(method->m_flags, false);
+    size += size_long((Long) method->source_hash, false);
+
+    if (method->packed)
+        return size + method->packed_len;
 
     size += size_long(method->num_args, false);
     for (i = 0; i < method->num_args; i++) {
@@ -734,17 +852,18 @@ static cBuf * pack_methods(cBuf *buf, const Obj *obj)
         buf = write_long(buf, obj->methods->tab[i].next);
     }
 
-    buf = pack_strings(buf, obj);
-    buf = pack_idents(buf, obj);
-
     return buf;
 }
 
 #define METHOD_STARTING_SIZE 7
 
-static void unpack_methods(const cBuf *buf, Long *buf_pos, Obj *obj)
+static void unpack_methods(const cBuf *buf, Long *buf_pos, Obj *obj,
+                           bool hashed)
 {
-    Int i, size;
+    Int     i, size, count;
+    Long    start;
+    cBuf   *region;
+    Method *method;
 
     size = read_long(buf, buf_pos);
 
@@ -761,16 +880,33 @@ static void unpack_methods(const cBuf *buf, Long *buf_pos, Obj *obj)
     obj->methods->hashtab = EMALLOC(Int, obj->methods->size);
     obj->methods->tab = EMALLOC(struct mptr, obj->methods->size);
 
+    start = *buf_pos;
+    count = 0;
     for (i = 0; i < obj->methods->size; i++) {
         obj->methods->hashtab[i] = read_long(buf, buf_pos);
-        obj->methods->tab[i].m = unpack_method(buf, buf_pos);
-        if (obj->methods->tab[i].m)
+        obj->methods->tab[i].m = unpack_method(buf, buf_pos, hashed);
+        if (obj->methods->tab[i].m) {
             obj->methods->tab[i].m->object = obj;
+            count++;
+        }
         obj->methods->tab[i].next = read_long(buf, buf_pos);
     }
 
-    unpack_strings(buf, buf_pos, obj);
-    unpack_idents(buf, buf_pos, obj);
+    /* Keep a copy of just the method table, rather than the whole object
+     * buffer, for the method bodies to be decoded from later. */
+    if (count) {
+        region = buffer_new(*buf_pos - start);
+        region->len = *buf_pos - start;
+        memcpy(region->s, &buf->s[start], region->len);
+        for (i = 0; i < obj->methods->size; i++) {
+            method = obj->methods->tab[i].m;
+            if (method) {
+                method->packed = buffer_dup(region);
+                method->packed_pos -= start;
+            }
+        }
+        buffer_discard(region);
+    }
 }
 
 static Int size_methods(Obj *obj, bool memory_size)
@@ -807,9 +943,6 @@ static Int size_methods(Obj *obj, bool memory_size)
         size += size_long(obj->methods->tab[i].next, false);
     }
 
-    size += size_strings(obj, false);
-    size += size_idents(obj, false);
-
     return size;
 }
 
@@ -1030,14 +1163,10 @@ Int size_data(cData *data, bool memory_size)
             size += size_dict(data->u.dict, memory_size);
             break;
 
-        case BUFFER: {
-            Int i;
-
+        case BUFFER:
             size += size_long(data->u.buffer->len, memory_size);
-            for (i = 0; i < data->u.buffer->len; i++)
-                size += size_long(data->u.buffer->s[i], memory_size);
+            size += data->u.buffer->len;
             break;
-        }
 
         default: {
             INSTANCE_RECORD(data->type, r);
@@ -1047,22 +1176,112 @@ Int size_data(cData *data, bool memory_size)
     return size;
 }
 
+static void write_section_end(cBuf *buf, Long base, ObjSection section)
+{
+    Long end = buf->len - base;
+    unsigned char *p = &buf->s[base + 1 + section * 4];
+
+    p[0] = end & 0xFF;
+    p[1] = (end >> 8) & 0xFF;
+    p[2] = (end >> 16) & 0xFF;
+    p[3] = (end >> 24) & 0xFF;
+}
+
+static Long read_section_end(const cBuf *buf, ObjSection section)
+{
+    const unsigned char *p = &buf->s[1 + section * 4];
+
+    return (Long) (p[0] | (p[1] << 8) | (p[2] << 16) | ((uLong) p[3] << 24));
+}
+
 cBuf * pack_object(cBuf *buf, const Obj *obj)
 {
+    static const unsigned char header[PACK_HEADER_SIZE] = { PACK_MAGIC_HASHED };
+    Long base = buf->len;
+
+    /* Leave room for the directory, and fill it in as we go. */
+    buf = buffer_append_uchars_single_ref(buf, header, PACK_HEADER_SIZE);
+
+    buf = write_ident(buf, obj->objname);
+    write_section_end(buf, base, SECTION_NAME);
     buf = pack_list(buf, obj->parents);
+    write_section_end(buf, base, SECTION_PARENTS);
     buf = pack_list(buf, obj->children);
+    write_section_end(buf, base, SECTION_CHILDREN);
     buf = pack_vars(buf, obj);
+    write_section_end(buf, base, SECTION_VARS);
     buf = pack_methods(buf, obj);
-    buf = write_ident(buf, obj->objname);
+    write_section_end(buf, base, SECTION_METHODS);
+    if (object_has_methods(obj)) {
+        buf = pack_strings(buf, obj);
+        buf = pack_idents(buf, obj);
+    }
+    write_section_end(buf, base, SECTION_STRINGS);
+
     return buf;
 }
 
+/* Find where a section of a packed object lies in buf, which need only hold
+ * the directory.  Returns false if the object predates the directory. */
+bool unpack_section_range(const cBuf *buf, ObjSection section,
+                          Long *start, Long *end)
+{
+    if (buf->len < PACK_HEADER_SIZE ||
+        (buf->s[0] != PACK_MAGIC && buf->s[0] != PACK_MAGIC_HASHED))
+        return false;
+
+    *start = section ? read_section_end(buf, section - 1) : PACK_HEADER_SIZE;
+    *end = read_section_end(buf, section);
+
+    return true;
+}
+
+/* Unpack only the name and parents of an object.  The rest of obj is left
+ * empty; see cache_retrieve_parents(). */
+void unpack_object_parents(const cBuf *buf, Obj *obj)
+{
+    Long buf_pos, end;
+
+    obj->objname = NOT_AN_IDENT;
+    if (unpack_section_range(buf, SECTION_NAME, &buf_pos, &end))
+        obj->objname = read_ident(buf, &buf_pos);
+    else
+        buf_pos = 0;
+    obj->parents = unpack_list(buf, &buf_pos);
+
+    obj->children = NULL;
+    obj->vars.tab = NULL;
+    obj->vars.hashtab = NULL;
+    obj->vars.blanks = 0;
+    obj->vars.size = 0;
+    obj->methods = NULL;
+}
+
 void unpack_object(const cBuf *buf, Long *buf_pos, Obj *obj)
 {
+    Long end;
+
+    if (unpack_section_range(buf, SECTION_NAME, buf_pos, &end)) {
+        obj->objname = read_ident(buf, buf_pos);
+        obj->parents = unpack_list(buf, buf_pos);
+        obj->children = unpack_list(buf, buf_pos);
+        unpack_vars(buf, buf_pos, obj);
+        unpack_methods(buf, buf_pos, obj, buf->s[0] == PACK_MAGIC_HASHED);
+        if (obj->methods) {
+            unpack_strings(buf, buf_pos, obj);
+            unpack_idents(buf, buf_pos, obj);
+        }
+        return;
+    }
+
     obj->parents = unpack_list(buf, buf_pos);
     obj->children = unpack_list(buf, buf_pos);
     unpack_vars(buf, buf_pos, obj);
-    unpack_methods(buf, buf_pos, obj);
+    unpack_methods(buf, buf_pos, obj, false);
+    if (obj->methods) {
+        unpack_strings(buf, buf_pos, obj);
+        unpack_idents(buf, buf_pos, obj);
+    }
     obj->objname = read_ident(buf, buf_pos);
 }
 
@@ -1075,8 +1294,14 @@ Int size_object(Obj *obj, bool memory_size)
     size += size_vars(obj, memory_size);
     size += size_methods(obj, memory_size);
 
-    if (!memory_size)
+    if (!memory_size) {
+        size += PACK_HEADER_SIZE;
         size += size_ident(obj->objname, memory_size);
+        if (object_has_methods(obj)) {
+            size += size_strings(obj, false);
+            size += size_idents(obj, false);
+        }
+    }
 
     if (memory_size) {
         size += sizeof(Obj);
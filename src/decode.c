@@ -28,7 +28,8 @@ static int format_flags;
 #define PAREN_ASSIGN 1
 #define NOPAREN_ASSIGN 0
 
-static Int count_lines(Int start, Int end, unsigned *flags);
+static Int count_lines(Int start, Int end, unsigned *flags, Int base,
+                       Int *lines);
 static Stmt_list *decompile_stmt_list(Int start, Int end);
 static Stmt *decompile_stmt(Int *pos_ptr);
 static Stmt *decompile_body(Int start, Int end);
@@ -118,8 +119,12 @@ static const struct {
     { INDEX,            12 }
 };
 
-Int line_number(Method *method, Int pc) {
-    Int count = 1;
+/* Build the method's table of which line each pc is on, with an entry for
+   each run of pcs on the same line, from the count count_lines() records
+   for each pc as it counts the whole method. */
+static void build_line_table(Method *method)
+{
+    Int n = method->num_opcodes, count = 1, pc, num, *lines;
     unsigned flags;
 
     if (method->num_args || method->rest != -1)
@@ -129,13 +134,61 @@ Int line_number(Method *method, Int pc) {
     if (count > 1)
         count++;
 
+    lines = TMALLOC(Int, n + 1);
+    for (pc = 0; pc < n; pc++)
+        lines[pc] = -1;
+
     the_opcodes = method->opcodes;
-    return count + count_lines(0, pc, &flags);
+    lines[n] = count + count_lines(0, n, &flags, count, lines);
+
+    num = 1;
+    for (pc = n - 1; pc >= 0; pc--) {
+        if (lines[pc] == -1)
+            lines[pc] = lines[pc + 1];
+        else if (lines[pc] != lines[pc + 1])
+            num++;
+    }
+
+    method->lines = TMALLOC(Line_entry, num);
+    method->num_lines = num;
+    num = 0;
+    for (pc = 0; pc <= n; pc++) {
+        if (pc == 0 || lines[pc] != lines[pc - 1]) {
+            method->lines[num].pc = pc;
+            method->lines[num].line = lines[pc];
+            num++;
+        }
+    }
+
+    TFREE(lines, n + 1);
 }
 
-static Int count_lines(Int start, Int end, unsigned *flags)
+Int line_number(Method *method, Int pc) {
+    Int lo, hi, mid;
+
+    if (!method->lines)
+        build_line_table(method);
+
+    /* Find the last run starting at or before pc. */
+    lo = 0;
+    hi = method->num_lines - 1;
+    while (lo < hi) {
+        mid = (lo + hi + 1) / 2;
+        if (method->lines[mid].pc <= pc)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return method->lines[lo].line;
+}
+
+/* Count the lines the instructions from start up to end decompile to.  If
+   lines is given, the count up to each pc, from base, is stored in it. */
+static Int count_lines(Int start, Int end, unsigned *flags, Int base,
+                       Int *lines)
 {
-    Int count=0, last=-1, next, complex_catch=0, with_start=0;
+    Int count=0, last=-1, next, complex_catch=0, with_start=0,
+        op_start, op_end, op_count, i;
 
     *flags = 0x0;
 
@@ -148,6 +201,12 @@ static Int count_lines(Int start, Int end, unsigned *flags)
         if (op_table[the_opcodes[start]].arg2)
             next++;
 
+        op_start = start;
+        op_end = next;
+        op_count = count;
+        if (lines)
+            lines[start] = base + count;
+
         /* Check for statement opcodes. */
         switch (the_opcodes[start]) {
 
@@ -175,7 +234,7 @@ static Int count_lines(Int start, Int end, unsigned *flags)
             break;
 
           case IF_ELSE: {
-              Int body_end;
+              Int body_end, else_count;
               unsigned if_flags = 0x0, else_flags = 0x0;
 
               /* Count "if (expr)" line and consider if body. */
@@ -185,10 +244,12 @@ static Int count_lines(Int start, Int end, unsigned *flags)
 
               if (end < body_end) {
                   /* End is inside if body. */
-                  return count + count_lines(start, end, &if_flags);
+                  return count + count_lines(start, end, &if_flags,
+                                             base + count, lines);
               } else {
                   /* Count if body. */
-                  count += count_lines(start, body_end, &if_flags);
+                  count += count_lines(start, body_end, &if_flags,
+                                       base + count, lines);
               }
 
               /* Count "else" line and consider else body. */
@@ -201,14 +262,32 @@ static Int count_lines(Int start, Int end, unsigned *flags)
                    * it contains a spanning if; if so, adjust count backwards
                    * by one to account for the "if (expr)" being on the same
                    * line as our "else".  Then count the body up to the end. */
-                  count_lines(start, body_end, &else_flags);
+                  count_lines(start, body_end, &else_flags, 0, NULL);
                   if (else_flags & SPANNING_IF_FLAG)
                       count--;
-                  return count + count_lines(start, end, &else_flags);
+                  return count + count_lines(start, end, &else_flags,
+                                             base + count, lines);
               }
 
               /* Count else body. */
-              count += count_lines(start, body_end, &else_flags);
+              else_count = count;
+              count += count_lines(start, body_end, &else_flags,
+                                   base + count, lines);
+
+              if (lines) {
+                  /* The else body's lines move back with it if it went on
+                     the same line as the "else", as counting up to a pc in
+                     it would have found.  The ELSE instruction is on the
+                     first line of the body too. */
+                  if (else_flags & SPANNING_IF_FLAG) {
+                      else_count--;
+                      for (i = start; i < body_end; i++) {
+                          if (lines[i] != -1)
+                              lines[i]--;
+                      }
+                  }
+                  lines[start - 2] = lines[start - 1] = base + else_count;
+              }
 
               if (else_flags & SPANNING_IF_FLAG) {
                   /* Adjust the count back one, since the "if (expr)" line went
@@ -263,11 +342,13 @@ static Int count_lines(Int start, Int end, unsigned *flags)
 
               if (end < body_end) {
                   /* End is in body. */
-                  return count + count_lines(start, end, &body_flags);
+                  return count + count_lines(start, end, &body_flags,
+                                             base + count, lines);
               }
 
               /* Count body.  If it's complex, count line for closing brace. */
-              count += count_lines(start, body_end, &body_flags);
+              count += count_lines(start, body_end, &body_flags,
+                                   base + count, lines);
               if (opcode != LAST_CASE_VALUE && opcode != LAST_CASE_RANGE) {
                   if (body_flags & COMPLEX_FLAG)
                       count++;
@@ -302,13 +383,15 @@ static Int count_lines(Int start, Int end, unsigned *flags)
 
               if (end < body_end) {
                   /* End is in switch body. */
-                  return count + count_lines(start, end, &body_flags);
+                  return count + count_lines(start, end, &body_flags,
+                                             base + count, lines);
               }
 
               /* Count switch body recursively (so that default case knows
                * where to stop).  If the default case was complex, count the
                * closing brace for the default case. */
-              count += count_lines(start, body_end, &body_flags);
+              count += count_lines(start, body_end, &body_flags,
+                                   base + count, lines);
 
               /* Count closing brace and set flags. */
               count++;
@@ -324,7 +407,8 @@ static Int count_lines(Int start, Int end, unsigned *flags)
 
               /* Switch bodies are counted recursively, so the end of the
                * default case is end.  Count default header and body. */
-              count += 1 + count_lines(next, end, &body_flags);
+              count += 1 + count_lines(next, end, &body_flags,
+                                       base + count + 1, lines);
               next = end;
               break;
           }
@@ -340,11 +424,13 @@ static Int count_lines(Int start, Int end, unsigned *flags)
 
               if (end < body_end) {
                   /* end is inside catch body. */
-                  return count + count_lines(start, end, &body_flags);
+                  return count + count_lines(start, end, &body_flags,
+                                             base + count, lines);
               }
 
               /* Count body and closing brace, if applicable */
-              body_lines = count_lines(start, body_end, &body_flags);
+              body_lines = count_lines(start, body_end, &body_flags,
+                                       base + count, lines);
               count += body_lines;
               if (body_lines > 1) {
                   count += 1;
@@ -394,6 +480,17 @@ static Int count_lines(Int start, Int end, unsigned *flags)
             break;
         }
 
+        /* Counting up to one of the instruction's arguments counts the
+           instruction, or the header line of a statement with a body. */
+        if (lines) {
+            if (next != op_end)
+                op_count++;
+            else
+                op_count = count;
+            for (i = op_start + 1; i < op_end && i < end; i++)
+                lines[i] = base + op_count;
+        }
+
         start = next;
     }
 
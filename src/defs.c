@@ -30,6 +30,7 @@ Int  heartbeat_freq;
 
 Int cache_width;
 Int cache_depth;
+Int method_cache_size;
 #ifdef USE_CLEANER_THREAD
 Int  cleaner_wait;
 cDict * cleaner_ignore_dict;
@@ -86,6 +87,7 @@ void init_defs(void) {
     errfile = stderr;
     cache_width = CACHE_WIDTH;
     cache_depth = CACHE_DEPTH;
+    method_cache_size = METHOD_CACHE_SIZE;
 
 #ifdef HAVE_STRUCT_TM_TM_ZONE
     time(&t);
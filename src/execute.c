@@ -9,6 +9,7 @@
 #include <stdarg.h>
 #include <ctype.h>
 #include "cdc_pcode.h"
+#include "operators.h"
 #include "cache.h"
 #include "util.h"
 #include "moddef.h"
@@ -344,7 +345,7 @@ static Int fork_method(Obj * obj,
         data_dup(&stack[stack_pos++], &current->stack[spos++]);
 
     result = frame_start(obj, method, sender, caller, user,
-                         0, arg_start - stack_start, is_frob);
+                         0, arg_start - stack_start, is_frob, false);
 
     if (result == CALL_ERROR) {
         /* we errored out, clean up the stack */
@@ -538,35 +539,57 @@ cList * vm_list(void) {
 /*
 // ---------------------------------------------------------------
 */
-cList * vm_stack(Frame * frame_to_trace, bool want_line_numbers) {
-    cList * r;
+/* Add a frame's entry to a stack() list.  Frames taken over by a run of
+   tail calls give how many as a sixth element. */
+static cList * add_stack_entry(cList * r, cObjnum objnum, Method * method,
+                               Int pc, Int count, bool want_line_numbers)
+{
     cData   d,
-           * list;
-    Frame  * f;
+          * list;
+    Int     len = (count > 1) ? 6 : 5;
 
-    r = list_new(0);
     d.type = LIST;
-    for (f = frame_to_trace; f; f = f->caller_frame) {
+    d.u.list = list_new(len);
+    list = list_empty_spaces(d.u.list, len);
+
+    list[0].type = OBJNUM;
+    list[0].u.objnum = objnum;
+    list[1].type = OBJNUM;
+    list[1].u.objnum = method->object->objnum;
+    list[2].type = SYMBOL;
+    list[2].u.symbol = ident_dup(method->name);
+    list[3].type = INTEGER;
+    if (want_line_numbers)
+        list[3].u.val = line_number(method, pc - 1);
+    else
+        list[3].u.val = -1;
+    list[4].type = INTEGER;
+    list[4].u.val = (Long) pc;
+    if (count > 1) {
+        list[5].type = INTEGER;
+        list[5].u.val = count;
+    }
 
-        d.u.list = list_new(5);
-        list = list_empty_spaces(d.u.list, 5);
-
-        list[0].type = OBJNUM;
-        list[0].u.objnum = f->object->objnum;
-        list[1].type = OBJNUM;
-        list[1].u.objnum = f->method->object->objnum;
-        list[2].type = SYMBOL;
-        list[2].u.symbol = ident_dup(f->method->name);
-        list[3].type = INTEGER;
-        if (want_line_numbers)
-            list[3].u.val = line_number(f->method, f->pc - 1);
-        else
-            list[3].u.val = -1;
-        list[4].type = INTEGER;
-        list[4].u.val = (Long) f->pc;
+    r = list_add(r, &d);
+    list_discard(d.u.list);
+    return r;
+}
 
-        r = list_add(r, &d);
-        list_discard(d.u.list);
+cList * vm_stack(Frame * frame_to_trace, bool want_line_numbers) {
+    cList       * r;
+    Frame       * f;
+    Tail_record * rec;
+    Int           i;
+
+    r = list_new(0);
+    for (f = frame_to_trace; f; f = f->caller_frame) {
+        r = add_stack_entry(r, f->object->objnum, f->method, f->pc, 1,
+                            want_line_numbers);
+        for (i = f->num_tail_records - 1; i >= 0; i--) {
+            rec = &f->tail_records[i];
+            r = add_stack_entry(r, rec->objnum, rec->method, rec->pc,
+                                rec->count, want_line_numbers);
+        }
     }
 
     return r;
@@ -734,7 +757,7 @@ void vm_task(cObjnum objnum, Ident name, Int num_args, ...) {
 
     /* start the task */
     ident_dup(name);
-    if (call_method(objnum, name, 0, 0, FROB_NO) == CALL_ERROR) {
+    if (call_method(objnum, name, 0, 0, FROB_NO, NULL) == CALL_ERROR) {
         pop(stack_pos);
     } else {
         execute();
@@ -759,7 +782,8 @@ void vm_task(cObjnum objnum, Ident name, Int num_args, ...) {
 */
 void vm_method(Obj *obj, Method *method) {
     clear_debug();
-    frame_start(obj, method, NOT_AN_IDENT, NOT_AN_IDENT, NOT_AN_IDENT, 0, 0, FROB_NO);
+    frame_start(obj, method, NOT_AN_IDENT, NOT_AN_IDENT, NOT_AN_IDENT, 0, 0, FROB_NO,
+                false);
 
     execute();
 
@@ -774,7 +798,331 @@ void vm_method(Obj *obj, Method *method) {
 
 /*
 // ---------------------------------------------------------------
+//
+// Superinstructions.  thread_method() points the first instruction of
+// some common sequences at a handler which does the work of the whole
+// sequence, saving a trip around execute() for each of the others.  The
+// opcodes themselves are left alone, so decompiling, line numbers and the
+// packed methods are unchanged.  The sequences were picked from the pair
+// and triple counts dumped by a PROFILE_EXECUTE build:
+//
+//     SET_LOCAL POP                       an assignment statement
+//     GET_LOCAL GET_LOCAL
+//     GET_LOCAL INTEGER|ONE <op>          arithmetic or a comparison with
+//                                         a constant, for integer locals
+//
+// Only the last instruction of a sequence can throw, and when it might
+// the handlers fall back on the plain ones, so pc and last_opcode are just
+// as they would have been when the error is raised.  A sequence costs a
+// tick for each instruction in it.
+*/
+
+static void fused_set_local_pop(void) {
+    cData * var;
+
+    /* Move the top of the stack into the variable, rather than copying
+       it and then popping it. */
+    var = &stack[cur_frame->var_start + cur_frame->opcodes[cur_frame->pc]];
+    cur_frame->pc += 2;
+    data_discard(var);
+    *var = stack[--stack_pos];
+}
+
+static void fused_get_local_get_local(void) {
+    Long * opcodes = cur_frame->opcodes;
+    Int    pc = cur_frame->pc,
+           var_start = cur_frame->var_start;
+
+    check_stack(2);
+    data_dup(&stack[stack_pos], &stack[var_start + opcodes[pc]]);
+    data_dup(&stack[stack_pos + 1], &stack[var_start + opcodes[pc + 2]]);
+    stack_pos += 2;
+    cur_frame->pc = pc + 3;
+}
+
+/* Run GET_LOCAL INTEGER|ONE <op> one instruction at a time, as execute()
+   would have. */
+static void local_const_unfused(void) {
+    Int opcode;
+
+    (*op_table[GET_LOCAL].func)();
+    opcode = cur_frame->opcodes[cur_frame->pc++];
+    cur_frame->last_opcode = opcode;
+    (*op_table[opcode].func)();
+    opcode = cur_frame->opcodes[cur_frame->pc++];
+    cur_frame->last_opcode = opcode;
+    (*op_table[opcode].func)();
+}
+
+#define LOCAL_CONST_OP(_name_, _op_) \
+    static void _name_(void) { \
+        Long * opcodes = cur_frame->opcodes; \
+        Int    pc = cur_frame->pc; \
+        cData * var = &stack[cur_frame->var_start + opcodes[pc]]; \
+        Long   val; \
+        \
+        if (var->type != INTEGER) { \
+            local_const_unfused(); \
+            return; \
+        } \
+        if (opcodes[pc + 1] == ONE) { \
+            val = var->u.val _op_ 1; \
+            cur_frame->pc = pc + 3; \
+        } else { \
+            val = var->u.val _op_ opcodes[pc + 2]; \
+            cur_frame->pc = pc + 4; \
+        } \
+        check_stack(1); \
+        stack[stack_pos].type = INTEGER; \
+        stack[stack_pos].u.val = val; \
+        stack_pos++; \
+    }
+
+LOCAL_CONST_OP(fused_local_add, +)
+LOCAL_CONST_OP(fused_local_subtract, -)
+LOCAL_CONST_OP(fused_local_multiply, *)
+LOCAL_CONST_OP(fused_local_divide, /)
+LOCAL_CONST_OP(fused_local_modulo, %)
+LOCAL_CONST_OP(fused_local_equal, ==)
+LOCAL_CONST_OP(fused_local_not_equal, !=)
+LOCAL_CONST_OP(fused_local_less, <)
+LOCAL_CONST_OP(fused_local_less_or_equal, <=)
+LOCAL_CONST_OP(fused_local_greater, >)
+LOCAL_CONST_OP(fused_local_greater_or_equal, >=)
+
+/* Point the first instruction of each sequence above at its handler, so
+   long as no jump lands inside the sequence. */
+static void fuse_method(Long * opcodes, Int n, Op_thread * threaded,
+                        char * leader)
+{
+    Int    pc, next, opcode, op_pc;
+    Long   num;
+    void (*func)(void);
+
+    for (pc = 0; pc < n; pc = next) {
+        opcode = opcodes[pc];
+        next = pc + 1 + (op_table[opcode].arg1 ? 1 : 0) +
+                        (op_table[opcode].arg2 ? 1 : 0);
+        if (next >= n || leader[next])
+            continue;
+
+        if (opcode == SET_LOCAL && opcodes[next] == POP) {
+            threaded[pc].func = fused_set_local_pop;
+            threaded[pc].ticks = 2;
+        } else if (opcode == GET_LOCAL && opcodes[next] == GET_LOCAL) {
+            threaded[pc].func = fused_get_local_get_local;
+            threaded[pc].ticks = 2;
+        } else if (opcode == GET_LOCAL &&
+                   (opcodes[next] == INTEGER || opcodes[next] == ONE)) {
+            if (opcodes[next] == ONE) {
+                num = 1;
+                op_pc = next + 1;
+            } else {
+                num = opcodes[next + 1];
+                op_pc = next + 2;
+            }
+            if (op_pc >= n || leader[op_pc])
+                continue;
+
+            switch (opcodes[op_pc]) {
+                case '+': func = fused_local_add;               break;
+                case '-': func = fused_local_subtract;          break;
+                case '*': func = fused_local_multiply;          break;
+                case '/': func = num ? fused_local_divide : NULL; break;
+                case '%': func = num ? fused_local_modulo : NULL; break;
+                case EQ:  func = fused_local_equal;             break;
+                case NE:  func = fused_local_not_equal;         break;
+                case '<': func = fused_local_less;              break;
+                case LE:  func = fused_local_less_or_equal;     break;
+                case '>': func = fused_local_greater;           break;
+                case GE:  func = fused_local_greater_or_equal;  break;
+                default:  func = NULL;                          break;
+            }
+            if (func) {
+                threaded[pc].func = func;
+                threaded[pc].ticks = 3;
+            }
+        }
+    }
+}
+
+/*
+// ---------------------------------------------------------------
+// Tail calls.  A call or pass() whose result is returned straight away,
+// with RETURN_EXPR the next instruction, need not keep the calling frame:
+// the method called takes it over (see frame_start()), so a method which
+// recurses in its return statement runs in constant space.  sender(),
+// caller() and calling_method() give what they would have.  The frame
+// keeps a record of those it took over, a run of calls from the same place
+// counted as one, so that tracebacks, stack() and the errors callers see
+// are as they would have been; only past TAIL_RECORDS runs are the oldest
+// forgotten.  In a catch or critical expression, or a handler, the calling
+// frame is still needed for errors, so there the call is made as usual.
+//
+// The tail handlers only set tail_call, which call_method() and
+// pass_method() take, so a call made by a native method on the way is
+// never mistaken for one.
+*/
+
+static bool tail_call = false;
+
+/* Add the method running in frame to its tail records, as it is taken
+   over.  The record keeps the frame's hold on the method. */
+static void record_tail_call(Frame * frame)
+{
+    Tail_record * rec;
+
+    if (frame->num_tail_records) {
+        rec = &frame->tail_records[frame->num_tail_records - 1];
+        if (rec->method == frame->method && rec->pc == frame->pc &&
+            rec->objnum == frame->object->objnum) {
+            rec->count++;
+            cache_discard(frame->method->object);
+            method_discard(frame->method);
+            return;
+        }
+    }
+
+    if (frame->num_tail_records == TAIL_RECORDS) {
+        rec = frame->tail_records;
+        cache_discard(rec->method->object);
+        method_discard(rec->method);
+        MEMMOVE(rec, rec + 1, TAIL_RECORDS - 1);
+        frame->num_tail_records--;
+    }
+
+    rec = &frame->tail_records[frame->num_tail_records++];
+    rec->method = frame->method;
+    rec->objnum = frame->object->objnum;
+    rec->pc = frame->pc;
+    rec->count = 1;
+}
+
+#define TAIL_OP(_name_, _op_) \
+    static void _name_(void) { \
+        tail_call = (!cur_frame->specifiers && !cur_frame->handler_info); \
+        _op_(); \
+        tail_call = false; \
+    }
+
+TAIL_OP(tail_message, op_message)
+TAIL_OP(tail_expr_message, op_expr_message)
+TAIL_OP(tail_pass, op_pass)
+
+static void mark_tail_calls(Long * opcodes, Int n, Op_thread * threaded)
+{
+    Int    pc, next, opcode;
+
+    for (pc = 0; pc < n; pc = next) {
+        opcode = opcodes[pc];
+        next = pc + 1 + (op_table[opcode].arg1 ? 1 : 0) +
+                        (op_table[opcode].arg2 ? 1 : 0);
+        if (next >= n || opcodes[next] != RETURN_EXPR)
+            continue;
+
+        switch (opcode) {
+            case CALL_METHOD:
+                threaded[pc].func = tail_message;
+                break;
+            case EXPR_CALL_METHOD:
+                threaded[pc].func = tail_expr_message;
+                break;
+            case PASS:
+                threaded[pc].func = tail_pass;
+                break;
+        }
+    }
+}
+
+/*
+// ---------------------------------------------------------------
+//
+// Translate a method's opcodes for execute().  Every instruction gets its
+// handler, so execute() need not look it up in op_table.  The basic blocks
+// are found for optimize_method() and the superinstructions above: a block
+// begins at the start of the method, at every jump target (which includes
+// error handlers and loop heads), and after every branch or return.
+//
+// Each instruction still costs a tick, as it always has.  A handler doing
+// the work of several instructions costs as many, so ticks_left() and the
+// point at which a method runs out of ticks are unchanged.
+//
 */
+static void thread_method(Method * method)
+{
+    Op_thread  * threaded;
+    Call_cache * caches;
+    Var_cache  * var_caches;
+    Long       * opcodes = method->opcodes;
+    Int          n = method->num_opcodes,
+                 pc, next, opcode, sites, var_sites;
+    Op_info    * info;
+    char       * leader;
+
+    /* The CALL_METHOD, GET_OBJ_VAR and SET_OBJ_VAR instructions' caches go
+       in the same block, after the table, so that method_free() need only
+       free the one. */
+    sites = var_sites = 0;
+    for (pc = 0; pc < n; pc = next) {
+        info = &op_table[opcodes[pc]];
+        next = pc + 1 + (info->arg1 ? 1 : 0) + (info->arg2 ? 1 : 0);
+        if (opcodes[pc] == CALL_METHOD)
+            sites++;
+        else if (opcodes[pc] == GET_OBJ_VAR || opcodes[pc] == SET_OBJ_VAR)
+            var_sites++;
+    }
+    threaded = (Op_thread *) emalloc((n + 1) * sizeof(Op_thread) +
+                                     sites * sizeof(Call_cache) +
+                                     var_sites * sizeof(Var_cache));
+    caches = (Call_cache *) (threaded + n + 1);
+    memset(caches, 0, sites * sizeof(Call_cache));
+    method->num_call_caches = sites;
+    var_caches = (Var_cache *) (caches + sites);
+    for (pc = 0; pc < var_sites; pc++)
+        var_caches[pc].objnum = INV_OBJNUM;
+
+    leader = EMALLOC(char, n + 1);
+    memset(leader, 0, n + 1);
+    leader[0] = 1;
+
+    for (pc = 0; pc < n; pc = next) {
+        opcode = opcodes[pc];
+        info = &op_table[opcode];
+        next = pc + 1 + (info->arg1 ? 1 : 0) + (info->arg2 ? 1 : 0);
+
+        threaded[pc].func = op_quickens(opcode) ? op_quicken : info->func;
+        threaded[pc].opcode = opcode;
+        threaded[pc].ticks = 1;
+        threaded[pc].next = next;
+        threaded[pc].skip_ticks = 0;
+        if (opcode == CALL_METHOD)
+            threaded[pc].u.cache = caches++;
+        else if (opcode == GET_OBJ_VAR || opcode == SET_OBJ_VAR)
+            threaded[pc].u.vars = var_caches++;
+        else
+            threaded[pc].u.cache = NULL;
+
+        if (info->arg1 == JUMP && opcodes[pc + 1] >= 0 && opcodes[pc + 1] < n)
+            leader[opcodes[pc + 1]] = 1;
+        if (info->arg2 == JUMP && opcodes[pc + 2] >= 0 && opcodes[pc + 2] < n)
+            leader[opcodes[pc + 2]] = 1;
+        if (info->arg1 == JUMP || info->arg2 == JUMP ||
+            opcode == RETURN || opcode == RETURN_EXPR)
+            leader[next < n ? next : n] = 1;
+    }
+
+    optimize_method(method, threaded, leader);
+
+    /* Profiling wants to see every instruction on its own. */
+#ifndef PROFILE_EXECUTE
+    fuse_method(opcodes, n, threaded, leader);
+#endif
+    mark_tail_calls(opcodes, n, threaded);
+
+    efree(leader);
+    method->threaded = threaded;
+}
+
 Int frame_start(Obj    * obj,
                 Method * method,
                 cObjnum  sender,
@@ -782,12 +1130,14 @@ Int frame_start(Obj    * obj,
                 cObjnum  user,
                 Int      stack_start,
                 Int      arg_start,
-                IsFrob   is_frob)
+                IsFrob   is_frob,
+                bool     tail)
 {
     Frame      * frame;
     Int          i,
                  num_args,
-                 num_rest_args;
+                 num_rest_args,
+                 shift;
     cList      * rest;
     cData      * d, o;
     Number_buf   nbuf1,
@@ -810,9 +1160,22 @@ Int frame_start(Obj    * obj,
         call_error(CALL_ERR_NUMARGS)
     }
 
-    if (frame_depth > limit_calldepth)
-        call_error(CALL_ERR_MAXDEPTH);
-    frame_depth++;
+    if (tail) {
+        /* Drop what the calling frame has on the stack, and move the
+           target and arguments down into its place. */
+        shift = stack_start - cur_frame->stack_start;
+        for (i = cur_frame->stack_start; i < stack_start; i++)
+            data_discard(&stack[i]);
+        MEMMOVE(&stack[cur_frame->stack_start], &stack[stack_start],
+                stack_pos - stack_start);
+        stack_pos -= shift;
+        stack_start -= shift;
+        arg_start -= shift;
+    } else {
+        if (frame_depth > limit_calldepth)
+            call_error(CALL_ERR_MAXDEPTH);
+        frame_depth++;
+    }
 
     if (method->rest != -1) {
         /* Make a list for the remaining arguments. */
@@ -829,22 +1192,49 @@ Int frame_start(Obj    * obj,
         list_discard(rest);
     }
 
-    if (frame_store) {
-        frame = frame_store;
-        frame_store = frame_store->caller_frame;
+    if (tail) {
+        /* Take the calling frame over.  Hold on to the new method and
+           objects before letting go of the old ones, which may be the
+           same. */
+        frame = cur_frame;
+        cache_grab(obj);
+        cache_grab(method->object);
+        method_dup(method);
+        record_tail_call(frame);
+        frame->tail_calls++;
+        cache_discard(frame->object);
+
+        /* The frames taken over no longer count toward limit_calldepth,
+           so past it the method runs on what ticks are left; a method
+           which tail calls itself forever still runs out. */
+        if (frame_depth + frame->tail_calls <= limit_calldepth)
+            frame->ticks = METHOD_TICKS;
     } else {
-        frame = EMALLOC(Frame, 1);
+        if (frame_store) {
+            frame = frame_store;
+            frame_store = frame_store->caller_frame;
+        } else {
+            frame = EMALLOC(Frame, 1);
+        }
+        cache_grab(obj);
+        cache_grab(method->object);
+        method_dup(method);
+        frame->ticks = METHOD_TICKS;
+        frame->tail_calls = 0;
+        frame->num_tail_records = 0;
+        frame->caller_frame = cur_frame;
     }
 
-    frame->object = cache_grab(obj);
+    frame->object = obj;
     frame->sender = sender;
     frame->caller = caller;
     frame->user = user;
-    frame->method = method_dup(method);
-    cache_grab(method->object);
+    frame->method = method;
+    if (!method->threaded)
+        thread_method(method);
     frame->opcodes = method->opcodes;
+    frame->threaded = method->threaded;
     frame->pc = 0;
-    frame->ticks = METHOD_TICKS;
 
     frame->specifiers = NULL;
     frame->handler_info = NULL;
@@ -862,7 +1252,6 @@ Int frame_start(Obj    * obj,
     }
     stack_pos += method->num_vars;
 
-    frame->caller_frame = cur_frame;
     cur_frame = frame;
 
 #ifdef DRIVER_DEBUG
@@ -958,6 +1347,10 @@ void frame_return(void) {
     cache_discard(cur_frame->method->object);
     method_discard(cur_frame->method);
     cache_discard(cur_frame->object);
+    for (i = 0; i < cur_frame->num_tail_records; i++) {
+        cache_discard(cur_frame->tail_records[i].method->object);
+        method_discard(cur_frame->tail_records[i].method);
+    }
 
     /* Discard any error action specifiers. */
     while (cur_frame->specifiers)
@@ -989,17 +1382,55 @@ struct meth_prof_s {
 
 Long prof_ops[LAST_TOKEN];
 
+/* Counts of opcodes run one after another, for choosing superinstructions
+   (see fuse_method()).  Triples are kept in a small hash table, and are
+   simply dropped once it fills up. */
+Long prof_pairs[LAST_TOKEN][LAST_TOKEN];
+
+#define PROFILE_TRIPLES 4096
+
+struct prof_triple_s {
+    Int   ops[3];
+    Long  count;
+} prof_triples[PROFILE_TRIPLES];
+
 void update_execute_opcode(Int opcode) {
     Int x;
+    uInt i;
     static short init = 1;
+    static Int last[2];
 
     if (init) {
         for (x=0; x < LAST_TOKEN; x++)
             prof_ops[x] = 0;
+        last[0] = last[1] = -1;
         init = 0;
     }
 
     prof_ops[opcode]++;
+
+    if (last[1] != -1)
+        prof_pairs[last[1]][opcode]++;
+
+    if (last[0] != -1) {
+        i = ((uInt) last[0] * 31 * 31 + last[1] * 31 + opcode) % PROFILE_TRIPLES;
+        for (x = 0; x < PROFILE_TRIPLES; x++, i = (i + 1) % PROFILE_TRIPLES) {
+            if (!prof_triples[i].count) {
+                prof_triples[i].ops[0] = last[0];
+                prof_triples[i].ops[1] = last[1];
+                prof_triples[i].ops[2] = opcode;
+            } else if (prof_triples[i].ops[0] != last[0] ||
+                       prof_triples[i].ops[1] != last[1] ||
+                       prof_triples[i].ops[2] != opcode) {
+                continue;
+            }
+            prof_triples[i].count++;
+            break;
+        }
+    }
+
+    last[0] = last[1];
+    last[1] = opcode;
 }
 
 void update_execute_method(Method * method) {
@@ -1036,7 +1467,8 @@ void update_execute_method(Method * method) {
 }
 
 void dump_execute_profile(void) {
-    Int x;
+    Int x, y, n, bx = 0, by = 0;
+    Long best;
     cStr * str;
     cData d;
 
@@ -1047,6 +1479,45 @@ void dump_execute_profile(void) {
                     prof_ops[x], x, op_table[x].name);
     }
 
+    /* The most common pairs and triples, most common first.  Each one
+       printed is zeroed so the next pass finds the next biggest. */
+    fputs("Opcode pairs:\n", errfile);
+    for (n = 0; n < 20; n++) {
+        best = 0;
+        for (x = 0; x < LAST_TOKEN; x++) {
+            for (y = 0; y < LAST_TOKEN; y++) {
+                if (prof_pairs[x][y] > best) {
+                    best = prof_pairs[x][y];
+                    bx = x;
+                    by = y;
+                }
+            }
+        }
+        if (!best)
+            break;
+        fprintf(errfile, "  %-10ld %s %s\n", best,
+                op_table[bx].name, op_table[by].name);
+        prof_pairs[bx][by] = 0;
+    }
+
+    fputs("Opcode triples:\n", errfile);
+    for (n = 0; n < 20; n++) {
+        best = 0;
+        for (x = 0; x < PROFILE_TRIPLES; x++) {
+            if (prof_triples[x].count > best) {
+                best = prof_triples[x].count;
+                bx = x;
+            }
+        }
+        if (!best)
+            break;
+        fprintf(errfile, "  %-10ld %s %s %s\n", best,
+                op_table[prof_triples[bx].ops[0]].name,
+                op_table[prof_triples[bx].ops[1]].name,
+                op_table[prof_triples[bx].ops[2]].name);
+        prof_triples[bx].count = -1;
+    }
+
     d.type = OBJNUM;
     fputs("Methods:\n", errfile);
     for (x=0; x < meth_p_last; x++) {
@@ -1069,38 +1540,61 @@ void dump_execute_profile(void) {
 #define MAX_NUM 2147483647
 #endif
 
+/* Charge the ticks for n instructions which an optimized handler skips,
+   if the frame has more than that left.  Otherwise charge nothing, and the
+   handler runs its instruction as compiled instead, so that the method
+   runs out of ticks on the same instruction it always has. */
+bool take_ticks(Int n) {
+    if (cur_frame->ticks <= n)
+        return false;
+    cur_frame->ticks -= n;
+    tick = (tick > MAX_NUM - n) ? tick - MAX_NUM - 1 + n : tick + n;
+    return true;
+}
+
 static void execute(void) {
-    Int opcode;
+    Op_thread * op;
+    void     (* func)(void);
+    Int         ticks;
 
     while (cur_frame) {
-        if (tick == MAX_NUM)
-            tick = -1;
-        tick++;
-        if ((--(cur_frame->ticks)) == 0) {
+        op = &cur_frame->threaded[cur_frame->pc];
+        func = op->func;
+        ticks = op->ticks;
+
+        /* Without the ticks for every instruction op does the work of,
+           run only the first, as compiled (see take_ticks()). */
+        if (ticks >= cur_frame->ticks) {
+            func = op_table[op->opcode].func;
+            ticks = 1;
+        }
+
+        tick = (tick > MAX_NUM - ticks) ? tick - MAX_NUM - 1 + ticks
+                                        : tick + ticks;
+        if ((cur_frame->ticks -= ticks) == 0) {
             out_of_ticks_error();
-        } else {
-            opcode = cur_frame->opcodes[cur_frame->pc];
+            continue;
+        }
 
 #if DEBUG_EXECUTE
-            fprintf(errfile, "<==> %d %s ",
-                    line_number(cur_frame->method, cur_frame->pc),
-                    op_table[cur_frame->opcodes[cur_frame->pc]].name);
-            write_err("%O.%I",
-                cur_frame->method->object->objnum,
-                ((cur_frame->method->name != NOT_AN_IDENT) ?
-                    cur_frame->method->name :
-                    opcode_id));
-    /*        fflush(errfile); */
+        fprintf(errfile, "<==> %d %s ",
+                line_number(cur_frame->method, cur_frame->pc),
+                op_table[op->opcode].name);
+        write_err("%O.%I",
+            cur_frame->method->object->objnum,
+            ((cur_frame->method->name != NOT_AN_IDENT) ?
+                cur_frame->method->name :
+                opcode_id));
+/*        fflush(errfile); */
 #endif
 
-            cur_frame->last_opcode = opcode;
-            cur_frame->pc++;
+        cur_frame->last_opcode = op->opcode;
+        cur_frame->pc++;
 
 #ifdef PROFILE_EXECUTE
-            update_execute_opcode(opcode);
+        update_execute_opcode(op->opcode);
 #endif
-            (*op_table[opcode].func)();
-        }
+        (*func)();
     }
 }
 
@@ -1138,7 +1632,7 @@ void anticipate_assignment(void) {
         d.type = INTEGER;
         d.u.val = 0;
         object_assign_var(cur_frame->object, cur_frame->method->object,
-                          id, &d);
+                          id, &d, NULL);
         break;
     }
 }
@@ -1201,6 +1695,9 @@ void pop_native_stack(Int start) {
 Int pass_method(Int stack_start, Int arg_start) {
     Method *method;
     Int result;
+    bool tail = tail_call;
+
+    tail_call = false;
 
     if (cur_frame->method->name == -1)
         call_error(CALL_ERR_METHNF);
@@ -1248,7 +1745,7 @@ Int pass_method(Int stack_start, Int arg_start) {
         else
             result = frame_start(cur_frame->object, method, cur_frame->sender,
                              cur_frame->caller, cur_frame->user, stack_start,
-                             arg_start, cur_frame->is_frob);
+                             arg_start, cur_frame->is_frob, tail);
     } else {
         call_native_method(method, stack_start, arg_start);
         result = CALL_NATIVE;
@@ -1260,17 +1757,58 @@ Int pass_method(Int stack_start, Int arg_start) {
 /*
 // ---------------------------------------------------------------
 */
+/* Let go of the method a call-site cache entry holds. */
+static void call_cache_drop(struct call_cache_entry * entry)
+{
+    Method * method = entry->method;
+
+    entry->method = NULL;
+    method->call_refs--;
+    method_discard(method);
+}
+
+static void call_cache_clear(Call_cache * cache)
+{
+    Int i;
+
+    for (i = 0; i < CALL_CACHE_ENTRIES; i++) {
+        if (cache->entries[i].method)
+            call_cache_drop(&cache->entries[i]);
+    }
+    cache->next = 0;
+}
+
+/* Empty the caches of a method's call sites, which come after its
+   threaded code (see thread_method()). */
+void method_forget_calls(Method * method)
+{
+    Call_cache * cache;
+    Int          i;
+
+    if (!method->threaded)
+        return;
+
+    cache = (Call_cache *) (method->threaded + method->num_opcodes + 1);
+    for (i = 0; i < method->num_call_caches; i++)
+        call_cache_clear(&cache[i]);
+}
+
 Int call_method(cObjnum objnum,     /* the object */
                 Ident name,         /* the method name */
                 Int stack_start,    /* start of the stack .. */
                 Int arg_start,      /* start of the args */
-                IsFrob is_frob)     /* how to look it up */
+                IsFrob is_frob,     /* how to look it up */
+                Call_cache * cache) /* the call site's cache, or NULL */
 {
     Obj * obj;
     Method * method;
-    Int        result;
+    Int        result, i;
     cObjnum   sender,
                caller, user;
+    struct call_cache_entry * entry;
+    bool       tail = tail_call;
+
+    tail_call = false;
 
     /* Get the target object from the cache. */
     obj = cache_retrieve(objnum);
@@ -1283,19 +1821,64 @@ Int call_method(cObjnum objnum,     /* the object */
         cur_frame->object->objnum == objnum)
         is_frob = FROB_YES;
 
-    /* Find the method to run. */
-    method = object_find_method(objnum, name, is_frob);
+    /* Find the method to run, trying what this call site found for the
+       same receiver before going to the method cache. */
+    method = NULL;
+    if (cache && cache->generation == method_generation) {
+        for (i = 0; i < CALL_CACHE_ENTRIES; i++) {
+            entry = &cache->entries[i];
+            if (entry->method && entry->objnum == objnum &&
+                entry->is_frob == is_frob &&
+                entry->obj_stamp == METHOD_OBJ_STAMP(objnum)) {
+                /* A method with no object was swapped out with it. */
+                if (!entry->method->object) {
+                    call_cache_drop(entry);
+                    break;
+                }
+
+                /* Hold the defining object as object_find_method() would.
+                   It is still loaded, but if nothing refers to it, it is
+                   on the inactive chain and must be moved back. */
+                method = entry->method;
+                if (method->object->refs)
+                    cache_grab(method->object);
+                else
+                    cache_retrieve(method->object->objnum);
+                break;
+            }
+        }
+    }
+
     if (!method) {
-        if (is_frob == FROB_YES) {
-            method = object_find_method(objnum, name, FROB_RETRY);
-            if (!method) {
+        method = object_find_method(objnum, name, is_frob);
+        if (!method) {
+            if (is_frob == FROB_YES) {
+                method = object_find_method(objnum, name, FROB_RETRY);
+                if (!method) {
+                    cache_discard(obj);
+                    call_error(CALL_ERR_METHNF);
+                }
+            }
+            else {
                 cache_discard(obj);
                 call_error(CALL_ERR_METHNF);
             }
         }
-        else {
-            cache_discard(obj);
-            call_error(CALL_ERR_METHNF);
+
+        if (cache) {
+            if (cache->generation != method_generation) {
+                call_cache_clear(cache);
+                cache->generation = method_generation;
+            }
+            entry = &cache->entries[cache->next];
+            cache->next = (cache->next + 1) % CALL_CACHE_ENTRIES;
+            if (entry->method)
+                call_cache_drop(entry);
+            entry->objnum = objnum;
+            entry->is_frob = is_frob;
+            entry->obj_stamp = METHOD_OBJ_STAMP(objnum);
+            entry->method = method_dup(method);
+            method->call_refs++;
         }
     }
 
@@ -1352,7 +1935,7 @@ Int call_method(cObjnum objnum,     /* the object */
                                  stack_start, arg_start, is_frob);
         else
             result = frame_start(obj, method, sender, caller, user,
-                                 stack_start, arg_start, is_frob);
+                                 stack_start, arg_start, is_frob, tail);
     } else {
         call_native_method(method, stack_start, arg_start);
         result = CALL_NATIVE;
@@ -1422,6 +2005,7 @@ PUSH_NATIVE(dict,   DICT,    cDict *,   dict)
 PUSH_NATIVE(symbol, SYMBOL,  Ident,      symbol)
 PUSH_NATIVE(error,  T_ERROR, Ident,      error)
 PUSH_NATIVE(buffer, BUFFER,  cBuf *, buffer)
+PUSH_NATIVE(sorted, SORTED_TYPE, cSorted *, instance)
 
 /*
 // ---------------------------------------------------------------
@@ -1672,74 +2256,43 @@ static Traceback_info *traceback_info_new(void) {
 
     new = (Traceback_info *) emalloc(sizeof(Traceback_info));
     new->type = 3;
+    new->count = 1;
     new->next = NULL;
+    new->last = new;
     return new;
 }
 
+/* Add new to the end of the traceback now, which the first entry's last
+   finds without walking the list. */
 static Traceback_info *traceback_info_add(Traceback_info *now,
                                             Traceback_info *new) {
-    Traceback_info *current;
-
-    current = now;
-
-    while (current->next != NULL) {
-        current = current->next;
-    }
-
-    current->next = new;
+    now->last->next = new;
+    now->last = new;
 
     return now;
 }
 
-Traceback_info *traceback_info_dup(Traceback_info *info) {
-    Traceback_info *new;
-
-    new = EMALLOC(Traceback_info, 1);
-    new->type = info->type;
-    switch(info->type) {
-        case 1:
-            new->location = ident_dup(info->location);
-            new->u.opcode = ident_dup(info->u.opcode);
-            break;
-        case 2:
-        case 3:
-            new->location = ident_dup(info->location);
-            new->u.method_name = EMALLOC(cData, 1);
-            data_dup(new->u.method_name, info->u.method_name);
-            new->current_obj = info->current_obj;
-            new->defining_obj = info->defining_obj;
-            new->method = method_dup(info->method);
-            new->pc = info->pc;
-    }
-
-    if (info->next != NULL) {
-        new->next = traceback_info_dup(info->next);
-    } else {
-        new->next = NULL;
-    }
-
-    return new;
-}
-
 static void traceback_info_discard(Traceback_info *info) {
-    if (info->next != NULL) {
-        traceback_info_discard(info->next);
-        info->next = NULL;
-    }
-    switch (info->type) {
-        case 1:
-            ident_discard(info->location);
-            ident_discard(info->u.opcode);
-            break;
-        case 2:
-        case 3:
-            ident_discard(info->location);
-            data_discard(info->u.method_name);
-            efree(info->u.method_name);
-            method_discard(info->method);
-            break;
+    Traceback_info *next;
+
+    for (; info; info = next) {
+        next = info->next;
+        switch (info->type) {
+            case 1:
+                ident_discard(info->location);
+                ident_discard(info->u.opcode);
+                break;
+            case 2:
+            case 3:
+                ident_discard(info->location);
+                if (info->u.method_name != NOT_AN_IDENT)
+                    ident_discard(info->u.method_name);
+                cache_discard(info->method->object);
+                method_discard(info->method);
+                break;
+        }
+        efree(info);
     }
-    efree(info);
 }
 
 void interp_error(Ident error, cStr *explanation)
@@ -1783,6 +2336,7 @@ void user_error(Ident error, cStr *explanation, cData *arg)
 
     /* The second through fifth elements are the current method info. */
     fill_in_method_info(location);
+    location = traceback_add_tail_calls(location, &error);
 
     /* Return from the current method, and propagate the error. */
     /* protect the current method, so that strings live long enough */
@@ -1797,6 +2351,7 @@ static void out_of_ticks_error(void)
     static cStr     * explanation;
     Traceback_info  * location;
     Method          * method;
+    Ident             error;
 
     /* Construct a list giving the location. */
     location = traceback_info_new();
@@ -1807,6 +2362,8 @@ static void out_of_ticks_error(void)
 
     /* The second through fifth elements are the current method info. */
     fill_in_method_info(location);
+    error = methoderr_id;
+    location = traceback_add_tail_calls(location, &error);
 
     /* Don't give the topmost frame a chance to return. */
     method = method_dup(cur_frame->method);
@@ -1814,7 +2371,7 @@ static void out_of_ticks_error(void)
 
     if (!explanation)
         explanation = string_from_chars("Out of ticks", 12);
-    start_error(methoderr_id, explanation, NULL, location);
+    start_error(error, explanation, NULL, location);
     method_discard(method);
 }
 
@@ -1875,7 +2432,8 @@ void propagate_error(Traceback_info * traceback, Ident error,
 
     /* If there's no current frame, drop all this on the floor. */
     if (!cur_frame) {
-        traceback_info_discard(traceback);
+        if (traceback)
+            traceback_info_discard(traceback);
         return;
     }
 
@@ -1974,9 +2532,45 @@ void propagate_error(Traceback_info * traceback, Ident error,
     }
 
     /* There was no handler in the current frame. */
+    if (!propagate)
+        error = methoderr_id;
+    traceback = traceback_add_tail_calls(traceback, &error);
     frame_return();
-    propagate_error(traceback, (propagate) ? error : methoderr_id,
-                    explanation, arg);
+    propagate_error(traceback, error, explanation, arg);
+}
+
+/* Add the frames the current one took over by tail calls to traceback,
+   as they would have been added had each returned with the error.  The
+   first is given error, which it would have been passed, and error is
+   then ~methoderr, since none of them can have been propagating it.
+   traceback may be NULL, leaving just that. */
+Traceback_info * traceback_add_tail_calls(Traceback_info * traceback,
+                                          Ident * error)
+{
+    Traceback_info * frame;
+    Tail_record    * rec;
+    Int              i;
+
+    for (i = cur_frame->num_tail_records - 1; i >= 0; i--) {
+        if (traceback) {
+            rec = &cur_frame->tail_records[i];
+            frame = traceback_info_new();
+            frame->location = ident_dup(*error);
+            frame->u.method_name = rec->method->name;
+            if (frame->u.method_name != NOT_AN_IDENT)
+                ident_dup(frame->u.method_name);
+            frame->current_obj = rec->objnum;
+            frame->defining_obj = rec->method->object->objnum;
+            frame->method = method_dup(rec->method);
+            cache_grab(frame->method->object);
+            frame->pc = rec->pc;
+            frame->count = rec->count;
+            traceback = traceback_info_add(traceback, frame);
+        }
+        *error = methoderr_id;
+    }
+
+    return traceback;
 }
 
 static Traceback_info * traceback_add(Traceback_info * traceback, Ident error)
@@ -2015,7 +2609,8 @@ void pop_handler_info(void)
     /* Free the data in the first handler info specifier, and pop it off that
      * stack. */
     old = cur_frame->handler_info;
-    traceback_info_discard(old->traceback);
+    if (old->traceback)
+        traceback_info_discard(old->traceback);
     if (old->cached_traceback)
         list_discard(old->cached_traceback);
     ident_discard(old->error);
@@ -2028,18 +2623,10 @@ void pop_handler_info(void)
 
 static void fill_in_method_info(Traceback_info *d)
 {
-    Ident method_name;
-
-    /* The method name, or 0 for eval. */
-    method_name = cur_frame->method->name;
-    d->u.method_name = (cData *)emalloc(sizeof(cData));
-    if (method_name == NOT_AN_IDENT) {
-        d->u.method_name->type = INTEGER;
-        d->u.method_name->u.val = 0;
-    } else {
-        d->u.method_name->type = SYMBOL;
-        d->u.method_name->u.symbol = ident_dup(method_name);
-    }
+    /* The method name, or NOT_AN_IDENT for eval. */
+    d->u.method_name = cur_frame->method->name;
+    if (d->u.method_name != NOT_AN_IDENT)
+        ident_dup(d->u.method_name);
 
     /* The current object. */
     d->current_obj = cur_frame->object->objnum;
@@ -2052,12 +2639,26 @@ static void fill_in_method_info(Traceback_info *d)
      * since it is only needed there.  Store the info
      * that we need to calculate it now though.  Store the method
      * now also so that should it get deleted or re-programmed,
-     * we will still get a valid line number.
+     * we will still get a valid line number, and keep its object
+     * in the cache, since swapping it out frees its methods.
      */
     d->method = method_dup(cur_frame->method);
+    cache_grab(d->method->object);
     d->pc = cur_frame->pc;
 }
 
+/* The method name in a traceback: a symbol, or 0 for eval. */
+static void method_name_data(cData *d, Ident method_name)
+{
+    if (method_name == NOT_AN_IDENT) {
+        d->type = INTEGER;
+        d->u.val = 0;
+    } else {
+        d->type = SYMBOL;
+        d->u.symbol = ident_dup(method_name);
+    }
+}
+
 cList *generate_traceback(Traceback_info *traceback) {
     cList *line, *tb;
     Traceback_info *current;
@@ -2123,7 +2724,7 @@ cList *generate_traceback(Traceback_info *traceback) {
     if (current->type != 1) {
         /* Second element is the method name */
         /* This might be integer 0 in some cases instead of an ident */
-        data_dup(d, current->u.method_name);
+        method_name_data(d, current->u.method_name);
         d++;
 
         /* The current object. */
@@ -2150,8 +2751,8 @@ cList *generate_traceback(Traceback_info *traceback) {
     current = current->next;
 
     while (current != NULL) {
-        line = list_new(5);
-        d = list_empty_spaces(line, 5);
+        line = list_new(current->count > 1 ? 6 : 5);
+        d = list_empty_spaces(line, current->count > 1 ? 6 : 5);
 
         /* First element is the error code. */
         d->type = T_ERROR;
@@ -2160,7 +2761,7 @@ cList *generate_traceback(Traceback_info *traceback) {
 
         /* Second element is the method name */
         /* This might be integer 0 in some cases instead of an ident */
-        data_dup(d, current->u.method_name);
+        method_name_data(d, current->u.method_name);
         d++;
 
         /* The current object. */
@@ -2177,6 +2778,13 @@ cList *generate_traceback(Traceback_info *traceback) {
         d->type = INTEGER;
         d->u.val = line_number(current->method, current->pc);
 
+        /* How many tail calls, for frames taken over by a run of them. */
+        if (current->count > 1) {
+            d++;
+            d->type = INTEGER;
+            d->u.val = current->count;
+        }
+
         elem.u.list = line;
         tb = list_add(tb, &elem);
         data_discard(&elem);
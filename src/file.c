@@ -326,7 +326,7 @@ cList * open_file(cStr * name, cStr * smode, Obj * obj) {
 
     /* parse the mode first, if the string pointer is NULL, set it readable */
     if (smode != NULL) {
-        s = smode->s;
+        s = string_chars(smode);
         if (*s == '+') {
             rw = 1;
             fnew->f.readable = fnew->f.writable = 1;
@@ -371,7 +371,7 @@ cList * open_file(cStr * name, cStr * smode, Obj * obj) {
         mode[2] = '\0';
     }
 
-    fnew->path = build_path(name->s, NULL, DISALLOW_DIR);
+    fnew->path = build_path(string_chars(name), NULL, DISALLOW_DIR);
     if (fnew->path == NULL)
         return NULL;
 
@@ -391,7 +391,7 @@ cList * open_file(cStr * name, cStr * smode, Obj * obj) {
     if (fnew->fp == NULL) {
         if (GETERR() == ERR_NOMEM)
             panic("open_file(): %s", strerror(GETERR()));
-        cthrow(file_id, "%s (%s)", strerror(GETERR()), name->s);
+        cthrow(file_id, "%s (%s)", strerror(GETERR()), string_chars(name));
         file_discard(fnew, NULL);
         return NULL;
     }
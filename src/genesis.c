@@ -336,6 +336,17 @@ static void initialize(Int argc, char **argv) {
                 }
                 break;
               }
+            case 'm':
+                argv += getarg(name,&buf,opt,argv,&argc,usage);
+                method_cache_size = atoi(buf);
+                if (method_cache_size <= 0 ||
+                    method_cache_size > METHOD_CACHE_MAX) {
+                    usage(name);
+                    fprintf(stderr,
+                            "** Invalid method cache size -m: '%s'\n", buf);
+                    exit(1);
+                }
+                break;
 #ifdef __UNIX__
             case 'g': {
                 struct group * gr;
@@ -647,6 +658,7 @@ Options:\n\n\
     -lg <file>  alternate driver (genesis) logfile, current: \"%s\"\n\
     -lp <file>  alternate runtime pid logfile, current: \"%s\"\n\
     -s <size>   Cache size, given as WIDTHxDEPTH, current: %dx%d\n\
+    -m <size>   Method cache entries, current: %d, at most %d\n\
     -n <name>   specify the hostname (rather than looking it up)\n\
     -u <user>   if running as root, setuid to this user.  This only works\n\
                 in unix.  Genesis must first be run as root.\n\
@@ -662,7 +674,7 @@ Options:\n\n\
 
      VERSION_MAJOR, VERSION_MINOR, VERSION_PATCH, name, c_dir_binary,
      c_dir_root, c_dir_bin, c_logfile, c_errfile, c_runfile, cache_width,
-     cache_depth);
+     cache_depth, method_cache_size, METHOD_CACHE_MAX);
 }
 
 /* TEMPORARY-- we need an area where identical functions 'names' (yet
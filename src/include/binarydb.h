@@ -23,6 +23,7 @@ void   init_binary_db(void);
 void   init_new_db(void);
 void   init_core_objects(void);
 bool   simble_get(Obj * object, cObjnum objnum, Long *obj_size);
+bool   simble_get_parents(Obj * object, cObjnum objnum);
 bool   simble_put(const Obj * object, cObjnum objnum, Long *obj_size);
 bool   simble_is_valid_objnum(cObjnum objnum);
 bool   simble_del(cObjnum objnum);
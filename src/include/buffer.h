@@ -9,6 +9,7 @@ cBuf  * buffer_new(Int len);
 cBuf  * buffer_dup(cBuf *buf);
 void    buffer_discard(cBuf *buf);
 cBuf  * buffer_append(cBuf *buf1, const cBuf *buf2);
+uLong   buffer_hash(cBuf *buf);
 Int     buffer_retrieve(const cBuf *buf, Int pos);
 cBuf  * buffer_replace(cBuf *buf, Int pos, uInt c);
 cBuf  * buffer_add(cBuf *buf, uInt c);
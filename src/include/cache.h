@@ -23,6 +23,7 @@ void cache_dirty_object(Obj *obj);
 
 Obj *cache_get_holder(cObjnum objnum);
 Obj *cache_retrieve(cObjnum objnum);
+Obj *cache_retrieve_parents(cObjnum objnum);
 Obj *cache_grab(Obj *object);
 void cache_discard(Obj *obj);
 bool cache_is_valid_objnum(cObjnum objnum);
@@ -17,5 +17,6 @@
 #include "native.h"
 #include "opcodes.h"
 #include "decode.h"
+#include "optimize.h"
 
 #endif
@@ -19,6 +19,8 @@ Int    string_packed_size(const cStr *str, bool memory_size);
 
 Int    string_cmp(const cStr * str1, const cStr * str2);
 cStr * string_add(cStr * str1, const cStr * str2);
+cStr * string_concat(cStr * str1, cStr * str2);
+cStr * string_flatten(cStr * str);
 cStr * string_add_chars(cStr * str, const char * s, Int len);
 cStr * string_addc(cStr * str, Int c);
 cStr * string_add_padding(cStr * str,
@@ -30,6 +32,7 @@ cStr * string_substring(cStr * str, Int start, Int len);
 cStr * string_uppercase(cStr * str);
 cStr * string_lowercase(cStr * str);
 regexp * string_regexp(cStr * str);
+uLong  string_hash(cStr * str);
 void   string_discard(cStr * str);
 cStr * string_parse(char * *sptr);
 cStr * string_add_unparsed(cStr * str, const char * s, Int len);
@@ -37,8 +40,12 @@ char * regerror(const char * msg);
 int    string_index(const cStr * str, const cStr * sub, int origin);
 cStr * string_prep(cStr *str, Int start, Int len);
 
+/* The chars of a concatenation are copied together when they are wanted. */
+#define string_flat(__s) \
+    ((__s)->left ? string_flatten((cStr *) (__s)) : (cStr *) (__s))
+
 #define string_length(__s) ((Int) __s->len)
-#define string_chars(__s) ((char *) __s->s + __s->start)
+#define string_chars(__s) ((char *) string_flat(__s)->s + (__s)->start)
 
 #endif
 
@@ -17,6 +17,7 @@ typedef struct cBuf       cBuf;
 typedef struct cFrob      cFrob;
 typedef struct cData      cData;
 typedef struct cDict      cDict;
+typedef struct cSorted    cSorted;
 typedef        Long       Ident;
 typedef        Long       cObjnum;
 typedef struct Obj        Obj;
@@ -26,6 +27,10 @@ typedef struct ident_entry  Ident_entry;
 typedef struct string_entry String_entry;
 typedef struct var          Var;
 typedef struct error_list   Error_list;
+typedef struct op_thread    Op_thread;
+typedef struct call_cache   Call_cache;
+typedef struct var_cache    Var_cache;
+typedef struct line_entry   Line_entry;
 typedef Int                 Object_string;
 typedef Int                 Object_ident;
 
@@ -36,14 +41,19 @@ struct cStr {
     Int len;
     Int size;
     Int refs;
+    uLong hash;     /* string_hash(), or 0 until it is needed */
     regexp * reg;
-    char s[1];
+    cStr * left;    /* a concatenation not yet copied; see string_concat() */
+    cStr * right;
+    char * s;       /* chars, normally, or NULL until a concatenation is */
+    char chars[1];  /* copied, when they are kept apart from the cStr */
 };
 
 struct cBuf {
     Int len;
     Int size;
     Int refs;
+    uLong hash;     /* buffer_hash(), or 0 until it is needed */
     unsigned char s[1];
 };
 
@@ -72,15 +82,26 @@ struct cList {
     Int len;
     Int size;
     Int refs;
-    cData el[1];
+    uLong hash;     /* list_hash(), or 0 until it is needed */
+    cList * left;   /* a concatenation not yet copied, or the list whose */
+    cList * right;  /* elements a sublist shares; see list_concat() */
+    cData * el;     /* elements, normally, or NULL until a concatenation */
+    cData elems[1]; /* is copied, when they are kept apart from the cList */
+};
+
+/* A slot of a dictionary's hash table: the position of a key in the keys
+ * and values lists, or -1 if the slot is empty, and the key's hash. */
+struct dict_slot {
+    Int      index;
+    uLong    hash;
 };
 
 struct cDict {
     cList  * keys;
     cList  * values;
-    Int    * links;
-    Int    * hashtab;
+    struct dict_slot * hashtab;
     Int      hashtab_size;
+    Int      holes;
     Int      refs;
 };
 
@@ -122,6 +143,7 @@ typedef struct cInstance {
 #include "cdc_string.h"
 #include "buffer.h"
 #include "dict.h"
+#include "sorted.h"
 #include "data.h"
 
 #endif
@@ -40,6 +40,8 @@
 #cmakedefine DEBUG_BUCKET_LOCK
 #cmakedefine DEBUG_CLEANER_LOCK
 
+#cmakedefine USE_READER_THREAD
+
 #cmakedefine USE_PARENT_OBJS
 
 #endif
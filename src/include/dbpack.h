@@ -5,6 +5,28 @@
 #ifndef cdc_dbpack_h
 #define cdc_dbpack_h
 
+/* Objects are packed as a directory followed by sections which can be
+ * unpacked independently.  The directory is PACK_MAGIC followed by the
+ * end offset of each section, as four byte little-endian numbers.  Objects
+ * packed before this layout begin with their parents list instead; since
+ * a packed Long never begins with PACK_MAGIC the two can be told apart.
+ * Objects are now written with PACK_MAGIC_HASHED, whose method headers
+ * also hold each method's source hash. */
+#define PACK_MAGIC        0xFF
+#define PACK_MAGIC_HASHED 0xFE
+
+typedef enum obj_section {
+    SECTION_NAME,
+    SECTION_PARENTS,
+    SECTION_CHILDREN,
+    SECTION_VARS,
+    SECTION_METHODS,
+    SECTION_STRINGS,
+    NUM_SECTIONS
+} ObjSection;
+
+#define PACK_HEADER_SIZE  (1 + NUM_SECTIONS * 4)
+
 cBuf * pack_object (cBuf * buf, const Obj * obj);
 cBuf * pack_data   (cBuf * buf, const cData * data);
 cBuf * write_ident (cBuf * buf, Ident id);
@@ -12,9 +34,14 @@ cBuf * write_long  (cBuf * buf, Long n);
 cBuf * write_float (cBuf * buf, Float f);
 
 void  unpack_object (const cBuf * buf, Long * buf_pos, Obj * obj);
+bool  unpack_section_range(const cBuf * buf, ObjSection section,
+                           Long * start, Long * end);
+void  unpack_object_parents(const cBuf * buf, Obj * obj);
 void  unpack_data   (const cBuf * buf, Long * buf_pos, cData * data);
+void  unpack_method_body(Method * method);
 Ident read_ident    (const cBuf * buf, Long * buf_pos);
 Long  read_long     (const cBuf * buf, Long * buf_pos);
+void  read_longs    (const cBuf * buf, Long * buf_pos, Long * dest, Int count);
 Float read_float    (const cBuf * buf, Long * buf_pos);
 
 Int  size_object(Obj * obj, bool memory_size);
@@ -146,17 +146,32 @@
 
 /*
 // ---------------------------------------------------------------------
-// size of method cache. use prime numbers and follow guidelines as
-// with the name cache above.
+// default number of entries in the method cache, which can be changed
+// with -m at startup or config('method_cache_size) while running.  The
+// entries are kept in sets of METHOD_CACHE_WAYS, the least recently used
+// of a set giving way to a new entry, and the number of sets is rounded
+// up to a power of two.  It can be no larger than METHOD_CACHE_MAX.
 */
-#define METHOD_CACHE_SIZE 1000003
+#define METHOD_CACHE_SIZE 65536
+#define METHOD_CACHE_WAYS 4
+#define METHOD_CACHE_MAX  4194304
 
 /*
 // ---------------------------------------------------------------------
-// size of ancestor cache. use prime numbers and follow guidelines as
-// with the name cache above.
+// number of stamps for invalidating the method cache entries of one
+// object (see method_cache_invalidate()).  Objects sharing a stamp lose
+// their entries together, so raise it if the cache is partially
+// invalidated often.  Use a prime number.
 */
-#define ANCESTOR_CACHE_SIZE 25601
+#define METHOD_STAMP_SIZE 16381
+
+/*
+// ---------------------------------------------------------------------
+// number of stamps for noticing changes to the parents of objects in the
+// ancestry index (see object_has_ancestor()), as METHOD_STAMP_SIZE above.
+// Use a prime number.
+*/
+#define ANCESTOR_STAMP_SIZE 16381
 
 /*
 // ---------------------------------------------------------------------
@@ -274,6 +289,7 @@ extern cInstance class_registry[];
 typedef enum instance_id {
     FIRST_INSTANCE = LAST_TOKEN + 1,
     HANDLED_FROB_TYPE = FIRST_INSTANCE,
+    SORTED_TYPE,
     LAST_INSTANCE
 } InstanceID;
 
@@ -309,6 +325,7 @@ extern Int  heartbeat_freq;
 
 extern Int cache_width;
 extern Int cache_depth;
+extern Int method_cache_size;
 #ifdef USE_CLEANER_THREAD
 extern pthread_mutex_t cleaner_lock;
 extern pthread_cond_t cleaner_condition;
@@ -16,6 +16,7 @@ Int dict_cmp(cDict * dict1, cDict * dict2);
 cDict * dict_add(cDict * dict, cData * key, cData * value);
 cDict * dict_del(cDict * dict, cData * key);
 cDict * dict_prep(cDict *);
+void dict_compact(cDict * dict);
 bool dict_find(const cDict * dict, cData * key, cData * ret);
 bool dict_contains(const cDict * dict, cData * key);
 cList * dict_keys(cDict * dict);
@@ -9,6 +9,7 @@ typedef struct frame Frame;
 typedef struct error_action_specifier Error_action_specifier;
 typedef struct handler_info Handler_info;
 typedef struct traceback_info Traceback_info;
+typedef struct tail_record Tail_record;
 typedef struct vmstate VMState;
 typedef struct vmstack VMStack;
 typedef struct task_s task_t;
@@ -59,6 +60,18 @@ struct task_s {
     task_t   * next;
 };
 
+/* The number of runs of tail calls a frame remembers; see frame_start(). */
+#define TAIL_RECORDS 8
+
+/* count tail calls in a row made from pc in method, running on objnum,
+   each of which took a frame over. */
+struct tail_record {
+    Method *method;
+    cObjnum objnum;
+    Int pc;
+    Int count;
+};
+
 struct frame {
     Obj *object;
     cObjnum sender;
@@ -66,6 +79,7 @@ struct frame {
     cObjnum user;
     Method *method;
     Long *opcodes;
+    Op_thread *threaded;
     Int pc;
     Int last_opcode;
     Int ticks;
@@ -75,6 +89,12 @@ struct frame {
     Error_action_specifier *specifiers;
     Handler_info *handler_info;
     Frame *caller_frame;
+
+    /* How many tail calls have taken this frame over, and the frames
+       they took, the last of them last.  See frame_start(). */
+    Int tail_calls;
+    Int num_tail_records;
+    Tail_record tail_records[TAIL_RECORDS];
 };
 
 struct error_action_specifier {
@@ -103,14 +123,16 @@ struct traceback_info {
     Int              type;
     Ident            location;
     union {
-        cData          * method_name;
+        Ident            method_name;   /* NOT_AN_IDENT for eval */
         Ident            opcode;
     } u;
     cObjnum          current_obj;
     cObjnum          defining_obj;
     Method         * method;
     Int              pc;
+    Int              count;             /* Of tail calls, if more than 1. */
     Traceback_info * next;
+    Traceback_info * last;              /* Only kept in the first entry. */
 };
 
 
@@ -171,15 +193,18 @@ Int  frame_start(Obj *obj,
                  cObjnum user,
                  Int stack_start,
                  Int arg_start,
-                 IsFrob is_frob);
+                 IsFrob is_frob,
+                 bool tail);
 void pop_native_stack(Int start);
 void frame_return(void);
 void anticipate_assignment(void);
 Int pass_method(Int stack_start, Int arg_start);
-Int call_method(cObjnum objnum, Ident message, Int stack_start, Int arg_start, IsFrob is_frob);
+Int call_method(cObjnum objnum, Ident message, Int stack_start, Int arg_start,
+                IsFrob is_frob, Call_cache * cache);
+void method_forget_calls(Method * method);
 void pop(Int n);
 void check_stack(Int n);
-Traceback_info *traceback_info_dup(Traceback_info *info);
+bool take_ticks(Int n);
 
 #define F_PUSH(_name_, _c_type_) \
     void CAT(push_, _name_) (_c_type_ var)
@@ -205,6 +230,7 @@ N_PUSH(dict,   cDict *);
 N_PUSH(symbol, Ident);
 N_PUSH(error,  Ident);
 N_PUSH(buffer, cBuf *);
+N_PUSH(sorted, cSorted *);
 
 #undef F_PUSH
 #undef N_PUSH
@@ -228,6 +254,8 @@ void cthrow(Ident id, const char *fmt, ...);
 void unignorable_error(Ident id, cStr *str);
 void interp_error(Ident error, cStr *str);
 void user_error(Ident error, cStr *str, cData *arg);
+Traceback_info * traceback_add_tail_calls(Traceback_info *traceback,
+                                          Ident *error);
 void propagate_error(Traceback_info *traceback, Ident error,
                      cStr *explnation, cData *arg);
 void pop_error_action_specifier(void);
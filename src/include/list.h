@@ -11,6 +11,7 @@ cData * list_empty_spaces(cList * list, Int spaces);
 Int     list_search(cList * list, cData * data);
 Int     list_binary_search(cList * list, cData * data, cData * key);
 Int     list_cmp(cList * l1, cList * l2);
+uLong   list_hash(cList * list);
 cList * list_insert(cList * list, Int pos, const cData * elem);
 cList * list_add(cList * list, cData * elem);
 cList * list_add_sorted(cList * list, cData * elem, cData * key);
@@ -19,6 +20,8 @@ cList * list_delete(cList * list, Int pos);
 cList * list_delete_element(cList * list, cData * elem);
 cList * list_delete_sorted_element(cList * list, cData * elem, cData * key);
 cList * list_append(cList * list1, const cList * list2);
+cList * list_concat(cList * list1, cList * list2);
+cList * list_flatten(cList * list);
 cList * list_reverse(cList * list);
 cList * list_setadd(cList * list, cData * elem);
 cList * list_setremove(cList * list, cData * elem);
@@ -29,12 +32,17 @@ cList * list_prep(cList * list, Int start, Int len);
 cStr  * list_join(cList * list, const cStr * sep);
 int     list_index(cList * list, cData * search, int origin);
 
+/* The elements of a concatenation are copied together when they are
+ * wanted, by list_first(), list_last() or list_elem(). */
+#define list_flat(__l) \
+    ((__l)->el ? (cList *) (__l) : list_flatten((cList *) (__l)))
+
 inline Int list_length(const cList *list) {
     return list->len;
 }
 
 inline cData *list_first(cList *list) {
-    return (list->len) ? list->el + list->start : NULL;
+    return (list->len) ? list_flat(list)->el + list->start : NULL;
 }
 
 inline cData *list_next(cList *list, cData *d) {
@@ -42,7 +50,8 @@ inline cData *list_next(cList *list, cData *d) {
 }
 
 inline cData *list_last(cList *list) {
-    return (list->len) ? list->el + list->start + list->len - 1 : NULL;
+    return (list->len) ? list_flat(list)->el + list->start + list->len - 1
+                       : NULL;
 }
 
 inline cData *list_prev(cList *list, cData *d) {
@@ -50,7 +59,7 @@ inline cData *list_prev(cList *list, cData *d) {
 }
 
 inline cData *list_elem(cList *list, Int i) {
-    return list->el + list->start + i;
+    return list_flat(list)->el + list->start + i;
 }
 
 #endif
@@ -247,6 +247,7 @@
 #define RETURN_FROB(d)    native_push_frob(d);   RETURN_TRUE
 #define RETURN_DICT(d)    native_push_dict(d);   RETURN_TRUE
 #define RETURN_LIST(d)    native_push_list(d);   RETURN_TRUE
+#define RETURN_SORTED(d)  native_push_sorted(d); RETURN_TRUE
 
 #define CLEAN_RETURN_INTEGER(d) CLEAN_STACK(); RETURN_INTEGER(d)
 #define CLEAN_RETURN_FLOAT(d)   CLEAN_STACK(); RETURN_FLOAT(d)
@@ -258,6 +259,7 @@
 #define CLEAN_RETURN_FROB(d)    CLEAN_STACK(); RETURN_FROB(d)
 #define CLEAN_RETURN_DICT(d)    CLEAN_STACK(); RETURN_DICT(d)
 #define CLEAN_RETURN_LIST(d)    CLEAN_STACK(); RETURN_LIST(d)
+#define CLEAN_RETURN_SORTED(d)  CLEAN_STACK(); RETURN_SORTED(d)
 
 #else /* NATIVE_MODULE */
 
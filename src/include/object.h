@@ -36,6 +36,28 @@ struct _ObjMethods {
 };
 typedef struct _ObjMethods ObjMethods;
 
+/* The order object_find_method() searches an object and its ancestors in,
+ * and the objects it found methods on, built when the object is first
+ * searched.  It is good while each ancestor's stamp is as it was when the
+ * order was worked out; see object_vtable() in object.c. */
+struct _ObjVtable {
+    Long      epoch;            /* method_epoch when last found good */
+    Int       num_ancestors;
+    cObjnum * ancestors;        /* the object itself last */
+    Long    * stamps;
+
+    /* Open hash on name, is_frob and after; unused entries have no name. */
+    struct vtable_entry {
+        Ident   name;
+        Int     is_frob;
+        cObjnum after;
+        cObjnum loc;            /* where the method is, or -2 for nowhere */
+    }       * tab;
+    Int       size;
+    Int       used;
+};
+typedef struct _ObjVtable ObjVtable;
+
 struct _ObjExtrasTable {
     void (*cleanup_all) (void);
     Int  (*cleanup)     (Obj * object, void * ptr);
@@ -71,6 +93,16 @@ struct Obj {
      * space. */
     ObjMethods *methods;
 
+    /* Where methods are found for this object, or NULL until it has been
+     * searched.  Only kept in memory. */
+    ObjVtable  *vtable;
+
+    /* Changed whenever a variable is added to or removed from vars, and
+     * whenever the object is loaded, never to a value it has had before.
+     * 64 bits, so that the count of them never wraps.  See
+     * object_var_slot(). */
+    uint64_t    vars_version;
+
     /* Information for the cache. */
     Int         refs;
     uInt        dirty;                 /* Flag: Object has been modified. */
@@ -79,6 +111,7 @@ struct Obj {
 #endif
     uLong       search;                /* Last cache search to visit this */
     char        dead;                  /* Flag: Object has been destroyed. */
+    char        partial;               /* Flag: Only parents are loaded. */
 
     /* Pointers to next and previous objects in cache chain. */
     Obj        *next_obj;
@@ -146,6 +179,62 @@ struct Method {
     Int m_access;       /* public, protected, private */
     Int m_flags;       /* overridable, synchronized, locked */
     Int refs;
+
+    /* How many of refs are held by call-site caches.  Once those are all
+       that is left, the method's code references are deleted and object is
+       set to NULL, since the caches do not keep the object loaded.  See
+       method_discard(). */
+    Int call_refs;
+
+    /* Methods read from disk only decode their header (name, access, flags
+       and native) up front.  Until the method is first found, the rest of
+       it stays in its packed form at packed_pos in packed, which is shared
+       by every method of the object.  See unpack_method_body(). */
+    cBuf *packed;
+    Int packed_pos;
+    Int packed_len;
+
+    /* opcodes translated for execute(), built when the method is first
+       run, followed by the caches of its num_call_caches CALL_METHOD
+       instructions.  See thread_method() in execute.c. */
+    Op_thread *threaded;
+    Int num_call_caches;
+
+    /* The line each pc is on, built when a line number is first wanted.
+       See line_number() in decode.c. */
+    Line_entry *lines;
+    Int num_lines;
+
+    /* A hash of the text the method was compiled from, or 0 if it was not
+       compiled from a text dump.  coldcc -p uses it to keep methods whose
+       text has not changed.  See method_source_hash() in textdb.c. */
+    uLong source_hash;
+};
+
+/* The first pc of a run of pcs decompiling to the same line. */
+struct line_entry {
+    Int pc;
+    Int line;
+};
+
+/* Each instruction's handler, indexed by the pc of the instruction.  ticks
+   is the number of instructions the handler does the work of, one unless
+   it stands for a sequence, which execute() charges before calling it.
+   Handlers installed by optimize_method() find where to go next in next,
+   and a folded constant or switch table in u.value.  Those which may
+   jump over instructions charge for them when they do, skip_ticks for a
+   threaded branch or for every case of a switch. */
+struct op_thread {
+    void (*func)(void);
+    Int opcode;
+    Int ticks;
+    Int next;
+    Int skip_ticks;
+    union {
+        Call_cache *cache;      /* CALL_METHOD, see call_method() */
+        Var_cache  *vars;       /* GET_OBJ_VAR and SET_OBJ_VAR */
+        cData      *value;
+    } u;
 };
 
 /* access: only one at a time */
@@ -177,6 +266,36 @@ typedef enum is_frob {
     FROB_ANY = 2,
 } IsFrob;
 
+/* The methods a CALL_METHOD instruction found for the last few receivers it
+   was sent to.  An entry is good while generation matches method_generation
+   and obj_stamp the receiver's METHOD_OBJ_STAMP(), as for the method cache.
+   Each entry holds a reference to its method, counted in call_refs, which
+   does not keep the method's object loaded; if the object is swapped out,
+   the method is left with no object and the entry is dropped when next
+   looked at.  See call_method(). */
+#define CALL_CACHE_ENTRIES 4
+
+struct call_cache {
+    Long generation;
+    Int  next;                  /* The entry to replace on a miss. */
+    struct call_cache_entry {
+        cObjnum  objnum;
+        IsFrob   is_frob;
+        Long     obj_stamp;
+        Method * method;
+    } entries[CALL_CACHE_ENTRIES];
+};
+
+/* Where a GET_OBJ_VAR or SET_OBJ_VAR instruction last found its variable
+   on the object it ran on.  The slot is good while that object and the
+   method's object both have the vars_version they had then. */
+struct var_cache {
+    cObjnum  objnum;
+    uint64_t version;
+    uint64_t cclass_version;
+    Int      slot;
+};
+
 /* Needed here for defs.c and cache.c */
 #define START_SEARCH_AT 0 /* zero is the 'unsearched' number */
 
@@ -186,6 +305,7 @@ typedef enum is_frob {
 extern Obj    *object_new(cObjnum objnum, cList *parents);
 extern void    object_alloc_methods(Obj *object);
 extern void    object_free(Obj *object);
+extern void    object_free_methods(Obj *object);
 extern void    object_destroy(Obj *object);
 extern void    object_construct_ancprec(Obj *object);
 extern Int     object_change_parents(Obj *object, cList *parents);
@@ -203,10 +323,10 @@ extern bool    object_defines_var(cObjnum object, Ident name);
 extern Ident   object_add_var(Obj *object, Ident name);
 extern Ident   object_del_var(Obj *object, Ident name);
 extern Ident   object_assign_var(Obj *object, Obj *cclass, Ident name,
-                                 cData *val);
+                                 cData *val, Var_cache *cache);
 extern Ident   object_delete_var(Obj *object, Obj *cclass, Ident name);
 extern Ident   object_retrieve_var(Obj *object, Obj *cclass, Ident name,
-                                   cData *ret);
+                                   cData *ret, Var_cache *cache);
 extern Ident   object_default_var(Obj *object, Obj *cclass, Ident name,
                                   cData *ret);
 extern Ident   object_inherited_var(Obj *object, Obj *cclass, Ident name,
@@ -215,6 +335,7 @@ extern bool    object_put_var(Obj *object, cObjnum cclass, Ident name,
                               cData *val);
 extern Method *object_find_method(cObjnum objnum, Ident name, IsFrob is_frob);
 extern Method *object_find_method_local(const Obj * obj, Ident name, IsFrob is_frob);
+extern Method *object_find_method_header(const Obj * obj, Ident name, IsFrob is_frob);
 extern Method *object_find_next_method(cObjnum objnum, Ident name,
                                        cObjnum after, IsFrob is_frob);
 extern bool    object_rename_method(Obj * object, Ident oname, Ident nname);
@@ -225,6 +346,7 @@ extern cList  *object_list_method(Obj *object, Ident name, Int indent,
 extern Method *method_new(void);
 extern void    method_free(Method *method);
 extern Method *method_dup(Method *method);
+extern Method *method_copy(Method *method, const Obj *from, Obj *object);
 extern void    method_discard(Method *method);
 extern bool    object_set_objname(Obj * object, Ident name);
 extern bool    object_del_objname(Obj * object);
@@ -239,6 +361,7 @@ extern void    object_load_parent_objs(Obj * obj);
 
 extern cList  *ancestor_cache_info(void);
 extern cList  *method_cache_info(void);
+extern Int     method_cache_resize(Int size);
 
 extern int     object_allocate_extra(
                    void (*cleanup_all) (void),
@@ -252,6 +375,14 @@ extern void    object_extra_cleanup_all(void);
 extern Long    db_top;
 extern Long    num_objects;
 extern uLong   cache_search;
+extern Long    method_generation;
+extern Long    method_obj_stamps[];
+
+/* Bumped whenever the methods found from objnum may change, while it has
+ * no children (see method_cache_invalidate()). */
+#define METHOD_OBJ_STAMP(_objnum_) \
+    method_obj_stamps[(uLong) (_objnum_) % METHOD_STAMP_SIZE]
+extern uint64_t vars_versions;
 
 #endif /* cdc_object_h_ */
 
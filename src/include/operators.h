@@ -92,4 +92,8 @@ void op_bwor(void);
 void op_bwshr(void);
 void op_bwshl(void);
 
+/* Quickening, see the end of operators.c */
+bool op_quickens(Int opcode);
+void op_quicken(void);
+
 #endif
@@ -0,0 +1,12 @@
+/*
+// Full copyright information is available in the file ../doc/CREDITS
+*/
+
+#ifndef cdc_optimize_h
+#define cdc_optimize_h
+
+void optimize_method(Method * method, Op_thread * threaded, char * leader);
+void optimize_free(Method * method);
+
+#endif
+
@@ -7,7 +7,15 @@
 
 #include "cdc_types.h"
 
-typedef cDict Hash;
+typedef struct Hash Hash;
+
+struct Hash {
+    cList  * keys;
+    Int    * links;
+    Int    * hashtab;
+    Int      hashtab_size;
+    Int      refs;
+};
 
 Hash * hash_new_with(cList *keys);
 Hash * hash_new(int size);
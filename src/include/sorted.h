@@ -0,0 +1,42 @@
+/*
+// Full copyright information is available in the file ../doc/CREDITS
+*/
+
+#ifndef cdc_sorted_h
+#define cdc_sorted_h
+
+#include "cdc_types.h"
+
+typedef struct sorted_node Sorted_node;
+
+/* A sorted list, kept as a counted B+tree so that elements can be added,
+ * removed and found by value or by position in O(log n).  If keyed, the
+ * elements are lists or dictionaries ordered by the element at index key,
+ * or the value of key, as with $list.sorted_insert(). */
+struct cSorted {
+    Int refs;
+    bool keyed;
+    cData key;
+    uLong hash;             /* sorted_hash(), or 0 until it is needed */
+    Sorted_node * root;     /* NULL when empty */
+};
+
+#define SORTED(_d_) ((cSorted *) ((_d_)->u.instance))
+
+cSorted * sorted_new(const cData * key);
+cSorted * sorted_from_list(cList * list, const cData * key);
+cSorted * sorted_dup(cSorted * sorted);
+void      sorted_discard(cSorted * sorted);
+Int       sorted_length(const cSorted * sorted);
+bool      sorted_valid_elem(const cData * key, const cData * elem);
+cSorted * sorted_insert(cSorted * sorted, const cData * elem);
+cSorted * sorted_delete(cSorted * sorted, Int pos);
+Int       sorted_search(cSorted * sorted, const cData * elem);
+Int       sorted_rank(cSorted * sorted, const cData * value, bool upper);
+cData   * sorted_elem(cSorted * sorted, Int pos);
+cList   * sorted_sublist(cSorted * sorted, Int start, Int len);
+cList   * sorted_to_list(cSorted * sorted);
+uLong     sorted_hash(cSorted * sorted);
+
+#endif
+
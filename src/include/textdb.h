@@ -6,6 +6,9 @@
 #define cdc_textdb_h
 
 extern bool force_native_overrides;
+extern Long methods_added;
+extern Long methods_changed;
+extern Long methods_unchanged;
 
 void compile_cdc_file(FILE * fp);
 Int text_dump(bool objnames);
@@ -27,7 +27,8 @@ extern int uppercase[NUM_CHARS];
 
 uLong hash_nullchar(const char *s);
 uLong hash_string(cStr * str);
-uLong hash_string_nocase(cStr * str);
+uLong hash_chars(const char *s, Int len, bool nocase);
+uLong hash_combine(uLong hash, uLong value);
 
 void       init_util(void);
 Long       atoln(const char *s, Int n);
@@ -211,8 +211,16 @@ Conn * find_connection(Obj * obj) {
 Conn * ctell(Obj * obj, const cBuf * buf) {
     Conn * conn = find_connection(obj);
 
-    if (conn != NULL)
-        conn->write_buf = buffer_append(conn->write_buf, buf);
+    /* If nothing is waiting to be written, keep a reference to buf rather
+     * than copying it; see connection_write(). */
+    if (conn != NULL) {
+        if (conn->write_buf->len == 0) {
+            buffer_discard(conn->write_buf);
+            conn->write_buf = buffer_dup((cBuf *) buf);
+        } else {
+            conn->write_buf = buffer_append(conn->write_buf, buf);
+        }
+    }
 
     return conn;
 }
@@ -339,6 +347,7 @@ static void connection_read(Conn *conn) {
     /* We successfully read some data.  Handle it. */
     socket_buffer->refs++;
     socket_buffer->len = len;
+    socket_buffer->hash = 0;
     d.type = BUFFER;
     d.u.buffer = socket_buffer;
     vm_task(conn->objnum, parse_id, 1, &d);
@@ -349,19 +358,33 @@ static void connection_read(Conn *conn) {
 // --------------------------------------------------------------------
 */
 static void connection_write(Conn *conn) {
-    cBuf *buf = conn->write_buf;
+    cBuf *buf = conn->write_buf, *rest;
     Int r;
 
     r = SOCK_WRITE(conn->fd, buf->s, buf->len);
     conn->flags.writable = 0;
 
-    /* We lost the connection. */
-    if ((r == SOCKET_ERROR) && (GETERR() != ERR_AGAIN)) {
-       conn->flags.dead = 1;
-       buf = buffer_resize(buf, 0);
+    if (r == SOCKET_ERROR) {
+        /* We lost the connection, or nothing could be written. */
+        if (GETERR() != ERR_AGAIN) {
+            conn->flags.dead = 1;
+            r = buf->len;
+        } else {
+            r = 0;
+        }
+    }
+
+    if (buf->refs > 1) {
+        /* buf is still held by the method which wrote it (see ctell()), so
+         * copy out what is left of it. */
+        rest = buffer_new(buf->len - r);
+        MEMCPY(rest->s, buf->s + r, buf->len - r);
+        rest->len = buf->len - r;
+        buffer_discard(buf);
+        buf = rest;
     } else {
-       MEMMOVE(buf->s, buf->s + r, buf->len - r);
-       buf = buffer_resize(buf, buf->len - r);
+        MEMMOVE(buf->s, buf->s + r, buf->len - r);
+        buf = buffer_resize(buf, buf->len - r);
     }
 
     conn->write_buf = buf;
@@ -11,6 +11,7 @@
 
 #include "defs.h"
 
+#include <stddef.h>
 #include <sys/types.h>
 
 /* This file supports a tray malloc and a pile malloc.  The tray malloc
@@ -21,9 +22,9 @@
  * The pile malloc enhances efficiency and convenience for applications
  * that allocate a lot of memory in small chunks and then free it all at
  * once.  We call new_pile() to get a handle on a 'pile' that we can
- * allocate memory from.  pile_malloc() accepts a pile in addition to the
- * size argument.  pile_free() frees all the used memory in a pile.  It
- * retains up to MAX_BLOCKS blocks of memory in the pile to avoid repeated
+ * allocate memory from.  pmalloc() accepts a pile in addition to the
+ * size argument.  pfree() frees all the used memory in a pile.  It
+ * retains up to MAX_PILE_BLOCKS blocks of memory in the pile to avoid repeated
  * mallocs and frees of large blocks. */
 
 #define MAX(a, b)        (((a) >= (b)) ? (a) : (b))
@@ -33,8 +34,9 @@
 #define MAX_USE_TRAY        (NUM_TRAYS * TRAY_INC)
 #define TRAY_ELEM        508
 
-#define PILE_BLOCK_SIZE 254
+#define PILE_BLOCK_SIZE 8192
 #define MAX_PILE_BLOCKS 8
+#define PILE_ALIGN      _Alignof(max_align_t)
 
 typedef struct tblock Tblocks;
 
@@ -51,14 +53,21 @@ struct tlist {
 
 typedef struct blink_s blink_t;
 
+/* A block of pile memory; its data follows the header. */
 struct blink_s {
-    void    * data;
     size_t    sz;
     blink_t * next;
 };
 
+#define BLINK_DATA(b) ((char *) (b) + PILE_HEADER)
+#define PILE_HEADER   ((sizeof(blink_t) + PILE_ALIGN - 1) & ~(PILE_ALIGN - 1))
+
 struct pile {
-    blink_t *blocks;
+    blink_t * blocks;           /* In use, the one handing out memory first. */
+    blink_t * spare;            /* Kept by pfree() for the next use. */
+    Int       num_spare;
+    char    * next;             /* Free space in the first of blocks. */
+    size_t    left;
 };
 
 static Tblocks *tray_blocks;
@@ -238,24 +247,67 @@ Pile *new_pile(void) {
 
     tmp=emalloc(sizeof(Pile));
     tmp->blocks=NULL;
+    tmp->spare=NULL;
+    tmp->num_spare=0;
+    tmp->next=NULL;
+    tmp->left=0;
 
     return tmp;
 }
 
 void free_pile(Pile *tmp) {
+    blink_t *roam;
+
     pfree(tmp);
+    while ((roam = tmp->spare)) {
+        tmp->spare = roam->next;
+        efree(roam);
+    }
     efree(tmp);
 }
 
+/* Memory is carved from the first block in order, so a compile costs a
+   malloc() per PILE_BLOCK_SIZE bytes rather than one per node.  Anything
+   too big to leave a block of use to others gets a block of its own, put
+   behind the first so that carving carries on where it was. */
 void * pmalloc(Pile *p, size_t s) {
     blink_t * blink;
+    void    * data;
+
+    s = (s + PILE_ALIGN - 1) & ~(PILE_ALIGN - 1);
+
+    if (s > PILE_BLOCK_SIZE / 4) {
+        blink = (blink_t*)emalloc(PILE_HEADER + s);
+        blink->sz = s;
+        if (p->blocks) {
+            blink->next = p->blocks->next;
+            p->blocks->next = blink;
+        } else {
+            blink->next = NULL;
+            p->blocks = blink;
+        }
+        return BLINK_DATA(blink);
+    }
+
+    if (s > p->left) {
+        if (p->spare) {
+            blink = p->spare;
+            p->spare = blink->next;
+            p->num_spare--;
+        } else {
+            blink = (blink_t*)emalloc(PILE_HEADER + PILE_BLOCK_SIZE);
+            blink->sz = PILE_BLOCK_SIZE;
+        }
+        blink->next = p->blocks;
+        p->blocks = blink;
+        p->next = BLINK_DATA(blink);
+        p->left = PILE_BLOCK_SIZE;
+    }
 
-    blink = (blink_t*)emalloc(sizeof(blink_t));
-    blink->data = tmalloc(s);
-    blink->sz = s;
-    blink->next = (blink_t *) p->blocks;
-    p->blocks = blink;
-    return blink->data;
+    data = p->next;
+    p->next += s;
+    p->left -= s;
+    return data;
 }
 
 void pfree(Pile *p) {
@@ -264,9 +316,16 @@ void pfree(Pile *p) {
       roam = p->blocks;
       while (roam) {
           ahead = roam->next;
-          tfree(roam->data, roam->sz);
-          efree(roam);
+          if (roam->sz == PILE_BLOCK_SIZE && p->num_spare < MAX_PILE_BLOCKS) {
+              roam->next = p->spare;
+              p->spare = roam;
+              p->num_spare++;
+          } else {
+              efree(roam);
+          }
           roam = ahead;
       }
       p->blocks = NULL;
+      p->next = NULL;
+      p->left = 0;
 }
@@ -38,6 +38,15 @@ NATIVE_METHOD(sorted_index);
 NATIVE_METHOD(sorted_insert);
 NATIVE_METHOD(sorted_delete);
 NATIVE_METHOD(sorted_validate);
+NATIVE_METHOD(list_to_sorted);
+NATIVE_METHOD(sortedlen);
+NATIVE_METHOD(sorted_add);
+NATIVE_METHOD(sorted_del);
+NATIVE_METHOD(sorted_find);
+NATIVE_METHOD(sorted_rank);
+NATIVE_METHOD(sorted_range);
+NATIVE_METHOD(subsorted);
+NATIVE_METHOD(sorted_to_list);
 NATIVE_METHOD(strftime);
 NATIVE_METHOD(next_objnum);
 NATIVE_METHOD(status);
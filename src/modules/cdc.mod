@@ -31,6 +31,15 @@ native $list.sorted_index()          sorted_index
 native $list.sorted_insert()         sorted_insert
 native $list.sorted_delete()         sorted_delete
 native $list.sorted_validate()       sorted_validate
+native $list.to_sorted()             list_to_sorted
+native $sorted.length()              sortedlen
+native $sorted.insert()              sorted_add
+native $sorted.delete()              sorted_del
+native $sorted.index()               sorted_find
+native $sorted.rank()                sorted_rank
+native $sorted.range()               sorted_range
+native $sorted.subrange()            subsorted
+native $sorted.to_list()             sorted_to_list
 native $string.length()              strlen
 native $string.subrange()            substr
 native $string.explode()             explode
@@ -63,4 +72,4 @@ native $integer.shleft()             shleft
 native $integer.shright()            shright
 native $integer.not()                not
 
-objs cdc.o cdc_buffer.o cdc_dict.o cdc_list.o cdc_misc.o cdc_string.o cdc_integer.o
+objs cdc.o cdc_buffer.o cdc_dict.o cdc_list.o cdc_sorted.o cdc_misc.o cdc_string.o cdc_integer.o
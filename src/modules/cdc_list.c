@@ -469,3 +469,27 @@ NATIVE_METHOD(sorted_delete) {
 NATIVE_METHOD(sorted_validate) {
     return 1;
 }
+
+NATIVE_METHOD(list_to_sorted) {
+    cSorted * sorted;
+    cData   * key,
+            * elem;
+
+    DEF_args;
+    DEF_argc;
+
+    if (argc != 1 && argc != 2)
+        THROW_NUM_ERROR(argc, "one or two");
+    INIT_ARG1(LIST);
+
+    key = (argc == 2) ? &args[ARG2] : NULL;
+    for (elem = list_first(LIST1); elem; elem = list_next(LIST1, elem)) {
+        if (!sorted_valid_elem(key, elem))
+            THROW((type_id, "%D does not have the key the list is sorted by.",
+                  elem));
+    }
+
+    sorted = sorted_from_list(LIST1, key);
+
+    CLEAN_RETURN_SORTED(sorted);
+}
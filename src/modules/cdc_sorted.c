@@ -0,0 +1,165 @@
+/*
+// Full copyright information is available in the file ../doc/CREDITS
+*/
+
+#define NATIVE_MODULE "$sorted"
+
+#include "cdc.h"
+
+#define SORTED1 SORTED(&args[ARG1])
+
+NATIVE_METHOD(sortedlen) {
+    Int len;
+
+    INIT_1_ARG(SORTED_TYPE);
+
+    len = sorted_length(SORTED1);
+
+    CLEAN_RETURN_INTEGER(len);
+}
+
+NATIVE_METHOD(sorted_add) {
+    cSorted * sorted;
+    cData     elem,
+            * key;
+    DEF_args;
+
+    INIT_ARGC(ARG_COUNT, 2, "two");
+    INIT_ARG1(SORTED_TYPE);
+
+    key = SORTED1->keyed ? &SORTED1->key : NULL;
+    if (!sorted_valid_elem(key, &args[ARG2]))
+        THROW((type_id, "%D does not have the key the list is sorted by.",
+              &args[ARG2]));
+
+    data_dup(&elem, &args[ARG2]);
+    sorted = sorted_dup(SORTED1);
+
+    CLEAN_STACK();
+    anticipate_assignment();
+
+    sorted = sorted_insert(sorted, &elem);
+    data_discard(&elem);
+
+    RETURN_SORTED(sorted);
+}
+
+NATIVE_METHOD(sorted_del) {
+    cSorted * sorted;
+    cData   * key;
+    Int       pos;
+    DEF_args;
+
+    INIT_ARGC(ARG_COUNT, 2, "two");
+    INIT_ARG1(SORTED_TYPE);
+
+    key = SORTED1->keyed ? &SORTED1->key : NULL;
+    if (!sorted_valid_elem(key, &args[ARG2]))
+        THROW((type_id, "%D does not have the key the list is sorted by.",
+              &args[ARG2]));
+
+    pos = sorted_search(SORTED1, &args[ARG2]);
+    if (pos == -1)
+        THROW((range_id, "Value must be within the list"));
+
+    sorted = sorted_dup(SORTED1);
+
+    CLEAN_STACK();
+    anticipate_assignment();
+
+    sorted = sorted_delete(sorted, pos);
+
+    RETURN_SORTED(sorted);
+}
+
+NATIVE_METHOD(sorted_find) {
+    cData * key;
+    Int     pos;
+    DEF_args;
+
+    INIT_ARGC(ARG_COUNT, 2, "two");
+    INIT_ARG1(SORTED_TYPE);
+
+    key = SORTED1->keyed ? &SORTED1->key : NULL;
+    if (!sorted_valid_elem(key, &args[ARG2]))
+        THROW((type_id, "%D does not have the key the list is sorted by.",
+              &args[ARG2]));
+
+    pos = sorted_search(SORTED1, &args[ARG2]);
+
+    /* Bring back to 1-based array index */
+    if (pos != -1)
+        pos++;
+
+    CLEAN_RETURN_INTEGER(pos);
+}
+
+/* The number of elements whose keys are less than the value given */
+NATIVE_METHOD(sorted_rank) {
+    Int rank;
+    DEF_args;
+
+    INIT_ARGC(ARG_COUNT, 2, "two");
+    INIT_ARG1(SORTED_TYPE);
+
+    rank = sorted_rank(SORTED1, &args[ARG2], false);
+
+    CLEAN_RETURN_INTEGER(rank);
+}
+
+/* The elements whose keys are between the two values given, inclusive */
+NATIVE_METHOD(sorted_range) {
+    Int       start,
+              end;
+    cList   * list;
+    DEF_args;
+
+    INIT_ARGC(ARG_COUNT, 3, "three");
+    INIT_ARG1(SORTED_TYPE);
+
+    start = sorted_rank(SORTED1, &args[ARG2], false);
+    end = sorted_rank(SORTED1, &args[ARG3], true);
+
+    if (end > start)
+        list = sorted_sublist(SORTED1, start, end - start);
+    else
+        list = list_new(0);
+
+    CLEAN_RETURN_LIST(list);
+}
+
+NATIVE_METHOD(subsorted) {
+    Int       start,
+              span,
+              len;
+    cList   * list;
+
+    INIT_2_OR_3_ARGS(SORTED_TYPE, INTEGER, INTEGER);
+
+    len = sorted_length(SORTED1);
+    start = INT2 - 1;
+    span = (argc == 3) ? INT3 : len - start;
+
+    /* Make sure range is in bounds. */
+    if (start < 0)
+        THROW((range_id, "Start (%d) less than one", start + 1));
+    else if (span < 0)
+        THROW((range_id, "Sublist length (%d) less than zero", span));
+    else if (start + span > len)
+        THROW((range_id, "Sublist extends to %d, past end of list (length %d)",
+              start + span, len));
+
+    list = sorted_sublist(SORTED1, start, span);
+
+    CLEAN_RETURN_LIST(list);
+}
+
+NATIVE_METHOD(sorted_to_list) {
+    cList * list;
+
+    INIT_1_ARG(SORTED_TYPE);
+
+    list = sorted_to_list(SORTED1);
+
+    CLEAN_RETURN_LIST(list);
+}
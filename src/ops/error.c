@@ -90,6 +90,7 @@ COLDC_FUNC(rethrow) {
     Traceback_info * traceback;
     cStr           * explanation;
     cData          * arg;
+    Ident            error;
 
     if (!func_init_1(&args, T_ERROR))
         return;
@@ -99,13 +100,18 @@ COLDC_FUNC(rethrow) {
         return;
     }
 
-    /* Abort the current frame and propagate an error in the caller. */
-    traceback = traceback_info_dup(cur_frame->handler_info->traceback);
+    /* Abort the current frame and propagate an error in the caller.  The
+       handler is about to go with the frame, so the traceback can be taken
+       from it rather than copied. */
+    traceback = cur_frame->handler_info->traceback;
+    cur_frame->handler_info->traceback = NULL;
     explanation = string_dup(cur_frame->handler_info->error_message);
     arg = (cData *)emalloc(sizeof(cData));
     data_dup(arg, cur_frame->handler_info->error_data);
+    error = ERR1;
+    traceback = traceback_add_tail_calls(traceback, &error);
     frame_return();
-    propagate_error(traceback, ERR1, explanation, arg);
+    propagate_error(traceback, error, explanation, arg);
     string_discard(explanation);
     data_discard(arg);
     efree(arg);
@@ -125,7 +125,7 @@ COLDC_FUNC(files) {
 
     INIT_1_ARG(STRING);
 
-    path = build_path(STR1->s, NULL, -1);
+    path = build_path(string_chars(STR1), NULL, -1);
     if (!path)
         return;
 
@@ -217,7 +217,7 @@ COLDC_FUNC(fchmod) {
     INIT_1_OR_2_ARGS(STRING, STRING);
 
     /* frob the string to a mode_t */
-    p = STR1->s;
+    p = string_chars(STR1);
 
     /* strtol sets an error if an overflow/underflow occurs */
     SETERR(0);
@@ -245,7 +245,7 @@ COLDC_FUNC(fchmod) {
     } else {
         struct stat sbuf;
 
-        path = build_path(STR2->s, &sbuf, ALLOW_DIR);
+        path = build_path(string_chars(STR2), &sbuf, ALLOW_DIR);
         if (path == NULL)
             return;
     }
@@ -276,7 +276,7 @@ COLDC_FUNC(frmdir) {
 
     INIT_1_ARG(STRING);
 
-    if (!(path = build_path(STR1->s, &sbuf, ALLOW_DIR)))
+    if (!(path = build_path(string_chars(STR1), &sbuf, ALLOW_DIR)))
         return;
 
     err = rmdir(path->s);
@@ -300,7 +300,7 @@ COLDC_FUNC(fmkdir) {
 
     INIT_1_ARG(STRING);
 
-    if (!(path = build_path(args[0].u.str->s, NULL, -1)))
+    if (!(path = build_path(string_chars(args[0].u.str), NULL, -1)))
         return;
 
     if (stat(path->s, &sbuf) == F_SUCCESS) {
@@ -335,7 +335,7 @@ COLDC_FUNC(fremove) {
 
     INIT_1_ARG(STRING);
 
-    path = build_path(STR1->s, &sbuf, DISALLOW_DIR);
+    path = build_path(string_chars(STR1), &sbuf, DISALLOW_DIR);
     if (!path)
         return;
 
@@ -397,11 +397,11 @@ COLDC_FUNC(frename) {
     if (args[0].type != STRING || !string_length(STR1)) {
         GET_FILE_CONTROLLER(file);
         from = string_dup(file->path);
-    } else if (!(from = build_path(args[0].u.str->s, &sbuf, ALLOW_DIR)))
+    } else if (!(from = build_path(string_chars(args[0].u.str), &sbuf, ALLOW_DIR)))
         return;
 
     /* stat it separately so that we can give a better error */
-    to = build_path(STR2->s, NULL, ALLOW_DIR);
+    to = build_path(string_chars(STR2), NULL, ALLOW_DIR);
     if (stat(to->s, &sbuf) == 0) {
         cthrow(file_id, "Destination \"%s\" already exists.", to->s);
         string_discard(to);
@@ -537,7 +537,7 @@ COLDC_FUNC(fwrite) {
             cthrow(type_id, "File type is text, you may only fwrite strings.");
             return;
         }
-        count = fwrite(args[0].u.str->s,
+        count = fwrite(string_chars(args[0].u.str),
                        sizeof(unsigned char),
                        args[0].u.str->len,
                        file->fp);
@@ -566,7 +566,7 @@ COLDC_FUNC(fstat) {
         GET_FILE_CONTROLLER(file);
         stat_file(file, &sbuf);
     } else {
-        cStr * path = build_path(STR1->s, &sbuf, ALLOW_DIR);
+        cStr * path = build_path(string_chars(STR1), &sbuf, ALLOW_DIR);
 
         /* if path == NULL build_path() threw an error */
         if (!path)
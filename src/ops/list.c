@@ -28,10 +28,10 @@ COLDC_FUNC(listgraft) {
     pop(3);
 
     if (pos == 0) {
-        l2 = list_append(l2, l1);
+        l2 = list_concat(l2, l1);
         push_list(l2);
     } else if (pos == list_length(l1)) {
-        l1 = list_append(l1, l2);
+        l1 = list_concat(l1, l2);
         push_list(l1);
     } else {
         new = list_new(list_length(l1) + list_length(l2));
@@ -62,7 +62,7 @@ COLDC_FUNC(anticipate_assignment) {
         d.type = INTEGER;
         d.u.val = 0;
         object_assign_var(caller_frame->object, caller_frame->method->object,
-                          id, &d);
+                          id, &d, NULL);
         break;
     }
     push_int(1);
@@ -194,7 +194,7 @@ COLDC_FUNC(cwritef) {
         return;
 
     /* Initialize the file */
-    str = build_path(args[0].u.str->s, &statbuf, DISALLOW_DIR);
+    str = build_path(string_chars(args[0].u.str), &statbuf, DISALLOW_DIR);
     if (str == NULL)
         return;
 
@@ -91,7 +91,7 @@ COLDC_FUNC(set_var) {
         return;
 
     result = object_assign_var(cur_frame->object, cur_frame->method->object,
-                               args[0].u.symbol, &args[1]);
+                               args[0].u.symbol, &args[1], NULL);
     if (result == varnf_id) {
         cthrow(varnf_id, "Object variable %I does not exist.", args[0].u.symbol);
     } else {
@@ -113,7 +113,7 @@ COLDC_FUNC(get_var) {
         return;
 
     result = object_retrieve_var(cur_frame->object, cur_frame->method->object,
-                                 args[0].u.symbol, &d);
+                                 args[0].u.symbol, &d, NULL);
     if (result == varnf_id) {
         cthrow(varnf_id, "Object variable %I does not exist.", args[0].u.symbol);
     } else {
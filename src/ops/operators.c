@@ -48,12 +48,14 @@ COLDC_OP(set_local) {
 COLDC_OP(set_obj_var) {
     Long ind, id, result;
     cData *val;
+    Var_cache *cache;
 
+    cache = cur_frame->threaded[cur_frame->pc - 1].u.vars;
     ind = cur_frame->opcodes[cur_frame->pc++];
     id = object_get_ident(cur_frame->method->object, ind);
     val = &stack[stack_pos - 1];
     result = object_assign_var(cur_frame->object, cur_frame->method->object,
-                               id, val);
+                               id, val, cache);
     if (result == varnf_id)
         cthrow(varnf_id, "Object variable %I not found.", id);
 }
@@ -680,12 +682,14 @@ COLDC_OP(get_local) {
 COLDC_OP(get_obj_var) {
     Long ind, id, result;
     cData val;
+    Var_cache *cache;
 
     /* Look for variable, and push it onto the stack if we find it. */
+    cache = cur_frame->threaded[cur_frame->pc - 1].u.vars;
     ind = cur_frame->opcodes[cur_frame->pc++];
     id = object_get_ident(cur_frame->method->object, ind);
     result = object_retrieve_var(cur_frame->object, cur_frame->method->object,
-                                 id, &val);
+                                 id, &val, cache);
     if (result == varnf_id) {
         cthrow(varnf_id, "Object variable %I not found.", id);
     } else {
@@ -757,7 +761,10 @@ COLDC_OP(message) {
     cObjnum objnum;
     Ident message;
     cFrob *frob;
+    Call_cache *cache;
 
+    /* The call site's cache, unless a handled frob changes the message. */
+    cache = cur_frame->threaded[cur_frame->pc - 1].u.cache;
     ind = cur_frame->opcodes[cur_frame->pc++];
     message = object_get_ident(cur_frame->method->object, ind);
 
@@ -786,6 +793,7 @@ COLDC_OP(message) {
                 Ident m = ident_dup(message);
                 int i;
 
+                cache = NULL;
                 check_stack(1);
                 target = &stack[arg_start - 1];
                 message = h->handler;
@@ -815,8 +823,8 @@ COLDC_OP(message) {
     /* Attempt to send the message. */
     ident_dup(message);
 
-    if (call_method(objnum, message, target - stack, arg_start, is_frob) ==
-                                                                   CALL_ERROR)
+    if (call_method(objnum, message, target - stack, arg_start, is_frob,
+                    cache) == CALL_ERROR)
         handle_method_error(objnum, message);
 
     ident_discard(message);
@@ -893,8 +901,8 @@ COLDC_OP(expr_message) {
     /* Attempt to send the message. */
     ident_dup(message);
 
-    if (call_method(objnum, message, target - stack, arg_start, is_frob) ==
-         CALL_ERROR)
+    if (call_method(objnum, message, target - stack, arg_start, is_frob,
+                    NULL) == CALL_ERROR)
         handle_method_error(objnum, message);
 
     ident_discard(message);
@@ -1541,7 +1549,7 @@ COLDC_OP(add) {
       string:                                                  /* string: */
 
         anticipate_assignment();
-        d1->u.str = string_add(d1->u.str, d2->u.str);
+        d1->u.str = string_concat(d1->u.str, d2->u.str);
         break;
 
       }
@@ -1551,7 +1559,7 @@ COLDC_OP(add) {
         switch (d2->type) {
             case LIST:
                 anticipate_assignment();
-                d1->u.list = list_append(d1->u.list, d2->u.list);
+                d1->u.list = list_concat(d1->u.list, d2->u.list);
                 break;
             case STRING: {
                 cStr * str = data_to_literal(d1, true);
@@ -1678,7 +1686,7 @@ COLDC_OP(doeq_add) {
         var->u.str = arg->u.str;
 
         /* ok, add, set and pop 'var' */
-        arg->u.str = string_add(str, arg->u.str);
+        arg->u.str = string_concat(str, arg->u.str);
         pop(1);
         return;
 
@@ -1691,7 +1699,7 @@ COLDC_OP(doeq_add) {
                 cList * list = var->u.list;
                 anticipate_assignment();
                 var->u.list = arg->u.list;
-                arg->u.list = list_append(list, arg->u.list);
+                arg->u.list = list_concat(list, arg->u.list);
                 pop(1);
                 return;
             }
@@ -1760,7 +1768,7 @@ COLDC_OP(splice_add) {
     }
 
     anticipate_assignment();
-    d1->u.list = list_append(d1->u.list, d2->u.list);
+    d1->u.list = list_concat(d1->u.list, d2->u.list);
     pop(1);
 }
 
@@ -1880,8 +1888,9 @@ COLDC_OP(increment) {
         case SET_OBJ_VAR: {
             Long ind, id, result;
             cData d;
+            Var_cache *cache;
 
-            cur_frame->pc++;
+            cache = cur_frame->threaded[cur_frame->pc++].u.vars;
             ind = cur_frame->opcodes[cur_frame->pc++];
             id  = object_get_ident(cur_frame->method->object, ind);
             if (sd->type == FLOAT) {
@@ -1893,7 +1902,7 @@ COLDC_OP(increment) {
             }
             result = object_assign_var(cur_frame->object,
                                        cur_frame->method->object,
-                                       id, &d);
+                                       id, &d, cache);
             if (result == varnf_id)
                 cthrow(varnf_id, "Object variable %I not found.", id);
             break;
@@ -1940,8 +1949,9 @@ COLDC_OP(decrement) {
         case SET_OBJ_VAR: {
             Long ind, id, result;
             cData d;
+            Var_cache *cache;
 
-            cur_frame->pc++;
+            cache = cur_frame->threaded[cur_frame->pc++].u.vars;
             ind = cur_frame->opcodes[cur_frame->pc++];
             id  = object_get_ident(cur_frame->method->object, ind);
             if (sd->type == FLOAT) {
@@ -1953,7 +1963,7 @@ COLDC_OP(decrement) {
             }
             result = object_assign_var(cur_frame->object,
                                        cur_frame->method->object,
-                                       id, &d);
+                                       id, &d, cache);
             if (result == varnf_id)
                 cthrow(varnf_id, "Object variable %I not found.", id);
             break;
@@ -2415,3 +2425,160 @@ COLDC_OP(bwshl) {
     }
 }
 
+
+/*
+// ----------------------------------------------------------------
+// Quickened operators.
+//
+// thread_method() starts the arithmetic and comparison operators off at
+// op_quicken(), which looks at the operands the first time the
+// instruction runs and replaces itself in the threaded table with a
+// version for two integers or two strings, falling back on the generic
+// operator for anything else.  The specialized versions check their
+// operands and put the generic operator back for good if they're ever
+// wrong.  Only the threaded table changes, never the opcodes.
+// ----------------------------------------------------------------
+*/
+
+static void deoptimize(void) {
+    Op_thread * op = &cur_frame->threaded[cur_frame->pc - 1];
+
+    op->func = op_table[op->opcode].func;
+    (*op->func)();
+}
+
+#define INT_OP(_name_, _expr_) \
+    static void _name_(void) { \
+        cData * d1 = &stack[stack_pos - 2]; \
+        cData * d2 = &stack[stack_pos - 1]; \
+        \
+        if (d1->type != INTEGER || d2->type != INTEGER) { \
+            deoptimize(); \
+            return; \
+        } \
+        d1->u.val = (_expr_); \
+        stack_pos--; \
+    }
+
+INT_OP(int_add,              d1->u.val + d2->u.val)
+INT_OP(int_subtract,         d1->u.val - d2->u.val)
+INT_OP(int_multiply,         d1->u.val * d2->u.val)
+INT_OP(int_equal,            d1->u.val == d2->u.val)
+INT_OP(int_not_equal,        d1->u.val != d2->u.val)
+INT_OP(int_less,             d1->u.val < d2->u.val)
+INT_OP(int_less_or_equal,    d1->u.val <= d2->u.val)
+INT_OP(int_greater,          d1->u.val > d2->u.val)
+INT_OP(int_greater_or_equal, d1->u.val >= d2->u.val)
+
+/* Division by zero is left to the generic operators to report, without
+   giving up on the integer version. */
+static void int_divide(void) {
+    cData * d1 = &stack[stack_pos - 2];
+    cData * d2 = &stack[stack_pos - 1];
+
+    if (d1->type != INTEGER || d2->type != INTEGER) {
+        deoptimize();
+    } else if (d2->u.val == 0) {
+        op_divide();
+    } else {
+        d1->u.val /= d2->u.val;
+        stack_pos--;
+    }
+}
+
+static void int_modulo(void) {
+    cData * d1 = &stack[stack_pos - 2];
+    cData * d2 = &stack[stack_pos - 1];
+
+    if (d1->type != INTEGER || d2->type != INTEGER) {
+        deoptimize();
+    } else if (d2->u.val == 0) {
+        op_modulo();
+    } else {
+        d1->u.val %= d2->u.val;
+        stack_pos--;
+    }
+}
+
+static void string_add_op(void) {
+    cData * d1 = &stack[stack_pos - 2];
+    cData * d2 = &stack[stack_pos - 1];
+
+    if (d1->type != STRING || d2->type != STRING) {
+        deoptimize();
+        return;
+    }
+    anticipate_assignment();
+    d1->u.str = string_concat(d1->u.str, d2->u.str);
+    pop(1);
+}
+
+/* Strings compare without regard to case, as in data_cmp(). */
+#define STRING_CMP_OP(_name_, _op_) \
+    static void _name_(void) { \
+        cData * d1 = &stack[stack_pos - 2]; \
+        cData * d2 = &stack[stack_pos - 1]; \
+        Int     val; \
+        \
+        if (d1->type != STRING || d2->type != STRING) { \
+            deoptimize(); \
+            return; \
+        } \
+        val = (strccmp(string_chars(d1->u.str), \
+                       string_chars(d2->u.str)) _op_ 0); \
+        pop(2); \
+        push_int(val); \
+    }
+
+STRING_CMP_OP(string_equal,            ==)
+STRING_CMP_OP(string_not_equal,        !=)
+STRING_CMP_OP(string_less,             <)
+STRING_CMP_OP(string_less_or_equal,    <=)
+STRING_CMP_OP(string_greater,          >)
+STRING_CMP_OP(string_greater_or_equal, >=)
+
+/* The version of opcode for operands of type, or NULL if there is none. */
+static void (*quickened(Int opcode, Int type))(void) {
+    if (type == INTEGER) {
+        switch (opcode) {
+            case '+': return int_add;
+            case '-': return int_subtract;
+            case '*': return int_multiply;
+            case '/': return int_divide;
+            case '%': return int_modulo;
+            case EQ:  return int_equal;
+            case NE:  return int_not_equal;
+            case '<': return int_less;
+            case LE:  return int_less_or_equal;
+            case '>': return int_greater;
+            case GE:  return int_greater_or_equal;
+        }
+    } else if (type == STRING) {
+        switch (opcode) {
+            case '+': return string_add_op;
+            case EQ:  return string_equal;
+            case NE:  return string_not_equal;
+            case '<': return string_less;
+            case LE:  return string_less_or_equal;
+            case '>': return string_greater;
+            case GE:  return string_greater_or_equal;
+        }
+    }
+    return NULL;
+}
+
+bool op_quickens(Int opcode) {
+    return quickened(opcode, INTEGER) != NULL;
+}
+
+void op_quicken(void) {
+    Op_thread * op = &cur_frame->threaded[cur_frame->pc - 1];
+    cData     * d1 = &stack[stack_pos - 2];
+    cData     * d2 = &stack[stack_pos - 1];
+    void     (* func)(void) = NULL;
+
+    if (d1->type == d2->type)
+        func = quickened(op->opcode, d1->type);
+    op->func = func ? func : op_table[op->opcode].func;
+    (*op->func)();
+}
@@ -273,6 +273,23 @@ COLDC_FUNC(set_heartbeat) {
             return; \
         }
 
+#define _CONFIG_METHOD_CACHE(id, var) \
+        if (SYM1 == id) { \
+            if (argc == 2) { \
+                if (args[ARG2].type != INTEGER) \
+                    THROW((type_id, "Expected an integer")); \
+                if (INT2 <= 0) \
+                    THROW((range_id, "The size must be above zero")); \
+                if (INT2 > METHOD_CACHE_MAX) \
+                    THROW((range_id, "The size can be at most %d", \
+                           METHOD_CACHE_MAX)); \
+                method_cache_resize(INT2); \
+            } \
+            pop(argc); \
+            push_int(var); \
+            return; \
+        }
+
 #define _CONFIG_OBJNUM(id, var) \
         if (SYM1 == id) { \
             if (argc == 2) { \
@@ -321,6 +338,7 @@ COLDC_FUNC(config) {
 #endif
     _CONFIG_INT(log_malloc_size_id,            log_malloc_size)
     _CONFIG_INT(log_method_cache_id,           log_method_cache)
+    _CONFIG_METHOD_CACHE(method_cache_size_id, method_cache_size)
 #ifdef USE_CACHE_HISTORY
     _CONFIG_INT(cache_history_size_id,         cache_history_size)
 #endif
@@ -184,11 +184,17 @@ COLDC_FUNC(stack) {
 }
 
 COLDC_FUNC(calling_method) {
+    Tail_record * rec;
+
     /* Accept no arguments, and push the name of the calling method */
     if (!func_init_0())
         return;
 
-    if (cur_frame->caller_frame)
+    /* A tail call took the calling method's frame over; see frame_start() */
+    if (cur_frame->num_tail_records) {
+        rec = &cur_frame->tail_records[cur_frame->num_tail_records - 1];
+        push_symbol(rec->method->name);
+    } else if (cur_frame->caller_frame)
         push_symbol(cur_frame->caller_frame->method->name);
     else
         push_int(0);
@@ -0,0 +1,572 @@
+/*
+// Full copyright information is available in the file ../doc/CREDITS
+//
+// Optimizations applied to a method's threaded code.
+//
+// These work on the table thread_method() builds rather than on the
+// opcodes, so the packed methods are unchanged and decompiling still gives
+// back exactly the source that was compiled.  Within each basic block:
+//
+//   - Runs of constants and the operators on them are folded, so that
+//     60 * 60, "a" + "b", [1, [2, 'x]] and #[["a", 1]] each push a value
+//     built once, when the method is first run.
+//   - IF, IF_ELSE and WHILE on a constant condition become a jump, so the
+//     branch not taken is never considered again.
+//
+// And across blocks, IF, IF_ELSE, ELSE and END which jump to an ELSE or
+// END go straight to where it would have taken them, and a switch whose
+// cases are all single constants finds its case in a dictionary built from
+// them rather than trying each in turn.
+//
+// Nothing folded can raise an error: an operation that would (dividing by
+// zero, adding a list to an integer) is left for the interpreter.  Each
+// still costs the ticks of the instructions it stands for, so a method runs
+// out of ticks where it always has.
+*/
+
+#include "defs.h"
+
+#include "cdc_pcode.h"
+#include "util.h"
+
+/* The longest chain of jumps followed when threading them. */
+#define MAX_JUMP_CHAIN 16
+
+/* Switches with fewer case values than this are left to try each one; it
+   is about where looking them up starts to pay. */
+#define MIN_SWITCH_TABLE 4
+
+/* A constant known to be on top of the stack: the instructions from start
+   up to end push it. */
+typedef struct {
+    Int   start;
+    Int   end;
+    bool  folded;        /* More than a single push. */
+    cData value;
+} Known;
+
+/* A START_ARGS seen since the known constants began. */
+typedef struct {
+    Int pc;
+    Int depth;
+} Args_mark;
+
+static Known     * known;
+static Int         known_size, num_known;
+static Args_mark * marks;
+static Int         marks_size, num_marks;
+
+/* ..................................................................... */
+/* handlers */
+
+static void push_folded(void) {
+    Op_thread * op = &cur_frame->threaded[cur_frame->pc - 1];
+
+    check_stack(1);
+    data_dup(&stack[stack_pos], op->u.value);
+    stack_pos++;
+    cur_frame->pc = op->next;
+}
+
+static void jump_threaded(void) {
+    cur_frame->pc = cur_frame->threaded[cur_frame->pc - 1].next;
+}
+
+/* The jumps skipped when the branch is taken cost skip_ticks. */
+static void if_threaded(void) {
+    Op_thread * op = &cur_frame->threaded[cur_frame->pc - 1];
+
+    if (data_true(&stack[stack_pos - 1])) {
+        cur_frame->pc++;
+    } else if (take_ticks(op->skip_ticks)) {
+        cur_frame->pc = op->next;
+    } else {
+        (*op_table[op->opcode].func)();
+        return;
+    }
+    pop(1);
+}
+
+/* Jump to the case in the dictionary at u.value matching the switch
+   expression, or to the DEFAULT at next.  The dictionary gives the pc of
+   each case's body and the ticks for the cases tried before finding it;
+   trying them all costs skip_ticks.  Floats compare equal to integers,
+   which the dictionary doesn't know, so they go through the cases as
+   SWITCH would have had them. */
+static void switch_table(void) {
+    Op_thread * op = &cur_frame->threaded[cur_frame->pc - 1];
+    cData     * expr = &stack[stack_pos - 1], body;
+    Int         pc, ticks;
+
+    if (expr->type == FLOAT) {
+        cur_frame->pc++;
+    } else if (dict_find(op->u.value->u.dict, expr, &body)) {
+        pc = list_elem(body.u.list, 0)->u.val;
+        ticks = list_elem(body.u.list, 1)->u.val;
+        data_discard(&body);
+        if (take_ticks(ticks)) {
+            pop(1);
+            cur_frame->pc = pc;
+        } else {
+            cur_frame->pc++;
+        }
+    } else if (take_ticks(op->skip_ticks)) {
+        cur_frame->pc = op->next;
+    } else {
+        cur_frame->pc++;
+    }
+}
+
+/* ..................................................................... */
+/* folding */
+
+/* The number of instructions from start up to end. */
+static Int instructions(Long * opcodes, Int start, Int end) {
+    Op_info * info;
+    Int       pc, count = 0;
+
+    for (pc = start; pc < end; count++) {
+        info = &op_table[opcodes[pc]];
+        pc += 1 + (info->arg1 ? 1 : 0) + (info->arg2 ? 1 : 0);
+    }
+    return count;
+}
+
+static void push_known(Int start, Int end, bool folded, cData * value) {
+    if (num_known == known_size) {
+        known_size = known_size * 2 + 8;
+        known = EREALLOC(known, Known, known_size);
+    }
+    known[num_known].start = start;
+    known[num_known].end = end;
+    known[num_known].folded = folded;
+    known[num_known].value = *value;
+    num_known++;
+}
+
+/* Forget everything known, installing push_folded() for each folded
+   constant still waiting to be used. */
+static void flush_known(Long * opcodes, Op_thread * threaded) {
+    Known * k;
+    Int     i;
+
+    for (i = 0; i < num_known; i++) {
+        k = &known[i];
+        if (k->folded) {
+            threaded[k->start].func = push_folded;
+            threaded[k->start].ticks = instructions(opcodes, k->start,
+                                                    k->end);
+            threaded[k->start].next = k->end;
+            threaded[k->start].u.value = EMALLOC(cData, 1);
+            *threaded[k->start].u.value = k->value;
+        } else {
+            data_discard(&k->value);
+        }
+    }
+    num_known = 0;
+    num_marks = 0;
+}
+
+/* The value a constant-pushing instruction pushes, or false if it isn't
+   one. */
+static bool constant_value(Method * method, Long * opcodes, Int pc,
+                           cData * d)
+{
+    switch (opcodes[pc]) {
+      case ZERO:
+      case ONE:
+        d->type = INTEGER;
+        d->u.val = (opcodes[pc] == ONE);
+        return true;
+      case INTEGER:
+        d->type = INTEGER;
+        d->u.val = opcodes[pc + 1];
+        return true;
+      case STRING:
+        d->type = STRING;
+        d->u.str = string_dup(object_get_string(method->object,
+                                                opcodes[pc + 1]));
+        return true;
+      case SYMBOL:
+        d->type = SYMBOL;
+        d->u.symbol = ident_dup(object_get_ident(method->object,
+                                                 opcodes[pc + 1]));
+        return true;
+      case T_ERROR:
+        d->type = T_ERROR;
+        d->u.error = ident_dup(object_get_ident(method->object,
+                                                opcodes[pc + 1]));
+        return true;
+      case OBJNUM:
+        d->type = OBJNUM;
+        d->u.objnum = opcodes[pc + 1];
+        return true;
+      default:
+        return false;
+    }
+}
+
+/* Apply a binary operator to two constants, as the interpreter would.
+   Returns false, leaving d1 and d2 alone, for anything that the
+   interpreter would raise an error for, or that isn't handled here. */
+static bool fold_binary(Int opcode, cData * d1, cData * d2, cData * r) {
+    Int cmp;
+
+    if (d1->type == INTEGER && d2->type == INTEGER) {
+        r->type = INTEGER;
+        switch (opcode) {
+          case '+': r->u.val = d1->u.val + d2->u.val;  return true;
+          case '-': r->u.val = d1->u.val - d2->u.val;  return true;
+          case '*': r->u.val = d1->u.val * d2->u.val;  return true;
+          case '/':
+          case '%':
+            /* Leave the interpreter to report dividing by zero, and to do
+               whatever the machine does dividing the most negative
+               number by -1. */
+            if (d2->u.val == 0 || d2->u.val == -1)
+                return false;
+            if (opcode == '/')
+                r->u.val = d1->u.val / d2->u.val;
+            else
+                r->u.val = d1->u.val % d2->u.val;
+            return true;
+          case EQ:  r->u.val = d1->u.val == d2->u.val; return true;
+          case NE:  r->u.val = d1->u.val != d2->u.val; return true;
+          case '<': r->u.val = d1->u.val < d2->u.val;  return true;
+          case LE:  r->u.val = d1->u.val <= d2->u.val; return true;
+          case '>': r->u.val = d1->u.val > d2->u.val;  return true;
+          case GE:  r->u.val = d1->u.val >= d2->u.val; return true;
+          default:  return false;
+        }
+    }
+
+    if (d1->type == STRING && d2->type == STRING) {
+        if (opcode == '+') {
+            r->type = STRING;
+            r->u.str = string_add(string_dup(d1->u.str), d2->u.str);
+            data_discard(d1);
+            data_discard(d2);
+            return true;
+        }
+        cmp = strccmp(string_chars(d1->u.str), string_chars(d2->u.str));
+        r->type = INTEGER;
+        switch (opcode) {
+          case EQ:  r->u.val = cmp == 0; break;
+          case NE:  r->u.val = cmp != 0; break;
+          case '<': r->u.val = cmp < 0;  break;
+          case LE:  r->u.val = cmp <= 0; break;
+          case '>': r->u.val = cmp > 0;  break;
+          case GE:  r->u.val = cmp >= 0; break;
+          default:  return false;
+        }
+        data_discard(d1);
+        data_discard(d2);
+        return true;
+    }
+
+    return false;
+}
+
+/* Build a LIST or DICT from the constants above the last START_ARGS. */
+static bool fold_args(Int opcode, cData * r) {
+    Int     depth = marks[num_marks - 1].depth, i;
+    cList * list;
+    cDict * dict;
+
+    list = list_new(num_known - depth);
+    for (i = depth; i < num_known; i++)
+        list = list_add(list, &known[i].value);
+
+    if (opcode == DICT) {
+        dict = dict_from_slices(list);
+        list_discard(list);
+        if (!dict)
+            return false;
+        r->type = DICT;
+        r->u.dict = dict;
+    } else {
+        r->type = LIST;
+        r->u.list = list;
+    }
+
+    for (i = depth; i < num_known; i++)
+        data_discard(&known[i].value);
+    num_known = depth;
+    return true;
+}
+
+/* A constant condition decides the branch at pc: jump from where the
+   constant began to wherever the branch goes. */
+static void fold_branch(Long * opcodes, Op_thread * threaded, Int pc) {
+    Known * k = &known[num_known - 1];
+    Int     next = pc + (opcodes[pc] == WHILE ? 3 : 2);
+    bool    taken;
+
+    taken = !data_true(&k->value);
+    threaded[k->start].func = jump_threaded;
+    threaded[k->start].ticks = instructions(opcodes, k->start, next);
+    if (taken)
+        threaded[k->start].next = opcodes[pc + 1];
+    else
+        threaded[k->start].next = next;
+
+    data_discard(&k->value);
+    num_known--;
+}
+
+static void fold_constants(Method * method, Op_thread * threaded,
+                           char * leader)
+{
+    Long  * opcodes = method->opcodes;
+    Int     n = method->num_opcodes,
+            pc, next, opcode, start;
+    Op_info * info;
+    cData   d, r;
+
+    num_known = num_marks = 0;
+
+    for (pc = 0; pc < n; pc = next) {
+        opcode = opcodes[pc];
+        info = &op_table[opcode];
+        next = pc + 1 + (info->arg1 ? 1 : 0) + (info->arg2 ? 1 : 0);
+
+        if (leader[pc])
+            flush_known(opcodes, threaded);
+
+        if (constant_value(method, opcodes, pc, &d)) {
+            push_known(pc, next, false, &d);
+            continue;
+        }
+
+        switch (opcode) {
+          case START_ARGS:
+            if (num_marks == marks_size) {
+                marks_size = marks_size * 2 + 8;
+                marks = EREALLOC(marks, Args_mark, marks_size);
+            }
+            marks[num_marks].pc = pc;
+            marks[num_marks].depth = num_known;
+            num_marks++;
+            continue;
+
+          case LIST:
+          case DICT:
+            if (!num_marks || marks[num_marks - 1].depth > num_known)
+                break;
+            start = marks[num_marks - 1].pc;
+            if (!fold_args(opcode, &r))
+                break;
+            num_marks--;
+            push_known(start, next, true, &r);
+            continue;
+
+          case '+': case '-': case '*': case '/': case '%':
+          case EQ: case NE: case '<': case LE: case '>': case GE:
+            if (num_known < 2 || (num_marks &&
+                                  marks[num_marks - 1].depth > num_known - 2))
+                break;
+            if (!fold_binary(opcode, &known[num_known - 2].value,
+                             &known[num_known - 1].value, &r))
+                break;
+            start = known[num_known - 2].start;
+            num_known -= 2;
+            push_known(start, next, true, &r);
+            continue;
+
+          case NEG:
+            if (!num_known || known[num_known - 1].value.type != INTEGER ||
+                (num_marks && marks[num_marks - 1].depth > num_known - 1))
+                break;
+            known[num_known - 1].value.u.val = -known[num_known - 1].value.u.val;
+            known[num_known - 1].end = next;
+            known[num_known - 1].folded = true;
+            continue;
+
+          case IF:
+          case IF_ELSE:
+          case WHILE:
+            if (!num_known ||
+                (num_marks && marks[num_marks - 1].depth > num_known - 1))
+                break;
+            fold_branch(opcodes, threaded, pc);
+            break;
+        }
+
+        /* Anything else uses the stack in ways not followed here. */
+        flush_known(opcodes, threaded);
+    }
+
+    flush_known(opcodes, threaded);
+}
+
+/* ..................................................................... */
+/* jump threading */
+
+/* Where a jump to dest ends up, and in *skipped how many jumps it takes
+   to get there. */
+static Int jump_destination(Long * opcodes, Int n, Int dest, Int * skipped) {
+    Int i;
+
+    for (i = 0; i < MAX_JUMP_CHAIN; i++) {
+        if (dest < 0 || dest >= n ||
+            (opcodes[dest] != ELSE && opcodes[dest] != END))
+            break;
+        dest = opcodes[dest + 1];
+    }
+    *skipped = i;
+    return dest;
+}
+
+static void thread_jumps(Method * method, Op_thread * threaded) {
+    Long * opcodes = method->opcodes;
+    Int    n = method->num_opcodes,
+           pc, next, opcode, dest, skipped;
+    Op_info * info;
+
+    for (pc = 0; pc < n; pc = next) {
+        opcode = opcodes[pc];
+        info = &op_table[opcode];
+        next = pc + 1 + (info->arg1 ? 1 : 0) + (info->arg2 ? 1 : 0);
+
+        if (opcode != IF && opcode != IF_ELSE && opcode != ELSE &&
+            opcode != END)
+            continue;
+        if (threaded[pc].func != info->func)
+            continue;
+
+        dest = jump_destination(opcodes, n, opcodes[pc + 1], &skipped);
+        if (dest == opcodes[pc + 1])
+            continue;
+
+        if (opcode == IF || opcode == IF_ELSE) {
+            threaded[pc].func = if_threaded;
+            threaded[pc].skip_ticks = skipped;
+        } else {
+            threaded[pc].func = jump_threaded;
+            threaded[pc].ticks += skipped;
+        }
+        threaded[pc].next = dest;
+    }
+}
+
+/* ..................................................................... */
+/* switch tables */
+
+/* The cases of the switch at pc, as a dictionary from each case value to
+   the pc of its body and the ticks for trying the cases up to it, if every
+   value is a constant.  A value given twice keeps the first body, which is
+   the one the cases would have found.  *default_ticks is what trying every
+   case costs. */
+static cDict * switch_cases(Method * method, Op_thread * threaded, Int pc,
+                            Int * default_pc, Int * default_ticks)
+{
+    Long  * opcodes = method->opcodes;
+    Int     n = method->num_opcodes,
+            p, q, next, count = 0, ticks = 0;
+    Op_info * info;
+    cDict * table;
+    cData   key, body, d;
+
+    table = dict_new_empty();
+    d.type = INTEGER;
+
+    for (p = pc + 2; p < n && opcodes[p] != DEFAULT; p = next) {
+        if (threaded[p].func == push_folded) {
+            data_dup(&key, threaded[p].u.value);
+            q = threaded[p].next;
+        } else if (constant_value(method, opcodes, p, &key)) {
+            info = &op_table[opcodes[p]];
+            q = p + 1 + (info->arg1 ? 1 : 0) + (info->arg2 ? 1 : 0);
+        } else {
+            break;
+        }
+
+        if (q + 1 < n && opcodes[q] == CASE_VALUE) {
+            d.u.val = opcodes[q + 1];
+            next = q + 2;
+        } else if (q + 1 < n && opcodes[q] == LAST_CASE_VALUE) {
+            d.u.val = q + 2;
+            next = opcodes[q + 1];
+        } else {
+            next = -1;
+        }
+
+        if (next <= p) {
+            data_discard(&key);
+            break;
+        }
+        ticks += instructions(opcodes, p, q + 2);
+        if (!dict_contains(table, &key)) {
+            body.type = LIST;
+            body.u.list = list_new(2);
+            body.u.list = list_add(body.u.list, &d);
+            d.u.val = ticks;
+            body.u.list = list_add(body.u.list, &d);
+            table = dict_add(table, &key, &body);
+            data_discard(&body);
+        }
+        data_discard(&key);
+        count++;
+    }
+
+    if (p >= n || opcodes[p] != DEFAULT || count < MIN_SWITCH_TABLE) {
+        dict_discard(table);
+        return NULL;
+    }
+    *default_pc = p;
+    *default_ticks = ticks;
+    return table;
+}
+
+static void table_switches(Method * method, Op_thread * threaded) {
+    Long  * opcodes = method->opcodes;
+    Int     n = method->num_opcodes,
+            pc, next, default_pc, default_ticks;
+    Op_info * info;
+    cDict * table;
+
+    for (pc = 0; pc < n; pc = next) {
+        info = &op_table[opcodes[pc]];
+        next = pc + 1 + (info->arg1 ? 1 : 0) + (info->arg2 ? 1 : 0);
+
+        if (opcodes[pc] != SWITCH)
+            continue;
+        table = switch_cases(method, threaded, pc, &default_pc,
+                             &default_ticks);
+        if (!table)
+            continue;
+
+        threaded[pc].func = switch_table;
+        threaded[pc].next = default_pc;
+        threaded[pc].skip_ticks = default_ticks;
+        threaded[pc].u.value = EMALLOC(cData, 1);
+        threaded[pc].u.value->type = DICT;
+        threaded[pc].u.value->u.dict = table;
+    }
+}
+
+/* ..................................................................... */
+
+void optimize_method(Method * method, Op_thread * threaded, char * leader) {
+    fold_constants(method, threaded, leader);
+    thread_jumps(method, threaded);
+    table_switches(method, threaded);
+}
+
+/* Free what optimize_method() added to a method's threaded code. */
+void optimize_free(Method * method) {
+    Op_thread * threaded = method->threaded;
+    Long      * opcodes = method->opcodes;
+    Op_info   * info;
+    Int         pc;
+
+    for (pc = 0; pc < method->num_opcodes;) {
+        if (threaded[pc].func == push_folded ||
+            threaded[pc].func == switch_table) {
+            data_discard(threaded[pc].u.value);
+            efree(threaded[pc].u.value);
+        }
+        info = &op_table[opcodes[pc]];
+        pc += 1 + (info->arg1 ? 1 : 0) + (info->arg2 ? 1 : 0);
+    }
+}
@@ -13,6 +13,9 @@
 
 #include <string.h>
 #include <ctype.h>
+#ifdef USE_READER_THREAD
+#include <pthread.h>
+#endif
 #include "cdc_db.h"
 #include "cdc_pcode.h"
 #include "coldcc.h"
@@ -42,6 +45,13 @@ Long       line_count;
 Long       method_start;
 Obj * cur_obj;
 static Hash * dump_hash;
+Long       methods_added;
+Long       methods_changed;
+Long       methods_unchanged;
+
+/* The methods of the last object a 'new object' replaced, kept so that
+   those whose text is unchanged can be copied instead of compiled again. */
+static Obj replaced;
 extern bool print_objs;
 extern bool print_invalid;
 extern bool print_warn;
@@ -114,7 +124,9 @@ extern bool print_warn;
 /*
 // ------------------------------------------------------------------------
 */
-static Method * get_method(FILE * fp, Obj * obj, const char * name);
+static Method * get_method(Obj * obj, Ident name, Method * old);
+static Method * compile_method(Obj * obj, Ident name, cList * code,
+                               Method * old);
 char * strchop(char * str, Int len);
 static void print_dbref(Obj * obj, cObjnum objnum, FILE * fp, bool objnames);
 static void blank_and_print_obj(const char * what, Float percent_done, Obj * obj);
@@ -553,6 +565,52 @@ static cObjnum parse_to_objnum(idref_t *ref) {
 // ------------------------------------------------------------------------
 */
 
+#ifndef ONLY_PARSE_TEXTDB
+static void keep_replaced_methods(Obj * target) {
+    object_free_methods(&replaced);
+    replaced.objnum = target->objnum;
+    replaced.methods = target->methods;
+    target->methods = NULL;
+}
+
+/* The method a definition of name on obj replaces, if any. */
+static Method * previous_method(Obj * obj, Ident name) {
+    Method * method;
+
+    method = object_find_method_header(obj, name, FROB_ANY);
+    if (!method && replaced.methods && replaced.objnum == obj->objnum)
+        method = object_find_method_header(&replaced, name, FROB_ANY);
+
+    return method;
+}
+
+/* FNV-1a over the lines of a method, each ended by a newline.  The top
+   bits are dropped, since write_long() cannot store them, and 0 is left
+   for methods which were not compiled from a text dump. */
+static uLong method_source_hash(cList * code) {
+#ifdef USE_BIG_NUMBERS
+    uLong   hash = 14695981039346656037ULL;
+    const uLong prime = 1099511628211ULL;
+#else
+    uLong   hash = 2166136261U;
+    const uLong prime = 16777619U;
+#endif
+    cData * d;
+    char  * s;
+    Int     len;
+
+    for (d = list_first(code); d; d = list_next(code, d)) {
+        s = string_chars(d->u.str);
+        for (len = string_length(d->u.str); len; len--, s++)
+            hash = (hash ^ (unsigned char) *s) * prime;
+        hash = (hash ^ '\n') * prime;
+    }
+
+    hash &= ((uLong) -1) >> 4;
+    return hash ? hash : 1;
+}
+#endif
+
 static Obj * handle_objcmd(const char * line, char * s, Int new) {
     idref_t   obj;
     char    * p = NULL,
@@ -677,6 +735,7 @@ static Obj * handle_objcmd(const char * line, char * s, Int new) {
             //
             if ((target = cache_retrieve(objnum))) {
                 WARN(("new: destroying existing object %s.", obj_str));
+                keep_replaced_methods(target);
                 cache_dirty_object(target);
                 target->dead = 1;
                 cache_discard(target);
@@ -987,7 +1046,7 @@ static void handle_varcmd(char * line, char * s, Int new, Int access) {
 /*
 // ------------------------------------------------------------------------
 */
-static void handle_evalcmd(FILE * fp, const char * s, Int new, Int access) {
+static void handle_evalcmd(const char * s, Int new, Int access) {
     Method * method;
 
 #ifndef ONLY_PARSE_TEXTDB
@@ -997,7 +1056,7 @@ static void handle_evalcmd(FILE * fp, const char * s, Int new, Int access) {
     name   = ident_get("coldcc_eval");
 
     /* grab the code */
-    method = get_method(fp, cur_obj, ident_name(name));
+    method = get_method(cur_obj, name, NULL);
 
     /* die if its invalid */
     if (!method)
@@ -1012,7 +1071,7 @@ static void handle_evalcmd(FILE * fp, const char * s, Int new, Int access) {
     method_discard(method);
     ident_discard(name);
 #else
-    method = get_method(fp, cur_obj, NULL);
+    method = get_method(cur_obj, NOT_AN_IDENT, NULL);
 #endif
 }
 
@@ -1039,7 +1098,7 @@ static Int get_method_name(const char * s, idref_t * id) {
     return count;
 }
 
-static void handle_bind_nativecmd(FILE * fp, const char * s) {
+static void handle_bind_nativecmd(const char * s) {
     idref_t    nat;
     idref_t    meth;
 #ifndef ONLY_PARSE_TEXTDB
@@ -1081,14 +1140,15 @@ static void handle_bind_nativecmd(FILE * fp, const char * s) {
 #endif
 }
 
-static void handle_methcmd(FILE * fp, char * s, Int new, Int access) {
+static void handle_methcmd(char * s, Int new, Int access) {
     char    * p = NULL;
 #ifndef ONLY_PARSE_TEXTDB
     cObjnum   definer;
     Ident     name;
 #endif
     idref_t   id = {INV_OBJNUM, NULL, 0, 0};
-    Method  * method;
+    Method  * method,
+            * old = NULL;
     Obj     * obj;
     Int       flags = MF_NONE;
 
@@ -1177,18 +1237,17 @@ static void handle_methcmd(FILE * fp, char * s, Int new, Int access) {
     if (*p != ';') {
 #ifndef ONLY_PARSE_TEXTDB
         /* get the method */
-        method = get_method(fp, obj, ident_name(name));
+        old = previous_method(obj, name);
+        method = get_method(obj, name, old);
     } else {
         cList * code = list_new(0);
-        cList * errors;
 
-        method = compile(obj, code, &errors);
+        old = previous_method(obj, name);
+        method = compile_method(obj, name, code, old);
 
         list_discard(code);
-        if (errors != NULL)
-            list_discard(errors);
 #else
-        method = get_method(fp, obj, NULL);
+        method = get_method(obj, NOT_AN_IDENT, NULL);
 #endif
     }
 
@@ -1196,17 +1255,36 @@ static void handle_methcmd(FILE * fp, char * s, Int new, Int access) {
     if (!method)
         DIEf("Method definition failed: %s", ident_name(name));
 
-    method->m_access = access;
-    method->m_flags = flags;
+    if (method == old) {
+        /* Its text is unchanged, so leave it be, and only touch the object
+           if the definition line changed. */
+        methods_unchanged++;
+        if (method->m_access != access)
+            object_set_method_access(obj, name, access);
+        if (method->m_flags != flags)
+            object_set_method_flags(obj, name, flags);
+    } else {
+        if (!old)
+            methods_added++;
+        else if (method->source_hash == old->source_hash)
+            methods_unchanged++;
+        else
+            methods_changed++;
+
+        method->m_access = access;
+        method->m_flags = flags;
 
-    object_add_method(obj, name, method);
+        object_add_method(obj, name, method);
+    }
 
     if (method->m_flags & MF_NATIVE) {
         Int x;
 
         x = find_native_method(obj->objname, name);
-        if (x != -1)
+        if (x != -1 && x != method->native) {
             method->native = x;
+            cache_dirty_object(obj);
+        }
 
         remember_native(method);
     }
@@ -1247,14 +1325,284 @@ static void frob_n_print_errstr(const char * err, const char * name, cObjnum obj
 }
 #endif
 
-static Method * get_method(FILE * fp, Obj * obj, const char * name) {
+#ifndef ONLY_PARSE_TEXTDB
+/* Compile a method's code, unless old was compiled from the same text, in
+   which case it is returned (or a copy of it, if it is not on obj)
+   instead. */
+static Method * compile_method(Obj * obj, Ident name, cList * code,
+                               Method * old) {
+    Method * method;
+    cList  * errors;
+    uLong    hash;
+    Int      i;
+
+    hash = method_source_hash(code);
+    if (old && old->source_hash == hash) {
+        if (old == object_find_method_header(obj, name, FROB_ANY))
+            return method_dup(old);
+        return method_copy(old, &replaced, obj);
+    }
+
+    method = compile(obj, code, &errors);
+    if (method)
+        method->source_hash = hash;
+
+    /* do warnings and errors, if they exist */
+    for (i = 0; i < errors->len; i++)
+        frob_n_print_errstr(string_chars(errors->el[i].u.str), ident_name(name),
+                            obj->objnum);
+
+    list_discard(errors);
+
+    return method;
+}
+#endif
+
+/*
+// ------------------------------------------------------------------------
+// The dump is split into units as it is read: a directive, and the body
+// of a method or an eval through the '};' which ends it.  With
+// USE_READER_THREAD this is done in a thread of its own, which queues the
+// units in order while this one takes lines off of them, so objects,
+// variables and methods are still installed (and compiled) one at a time
+// in the order of the dump.  The reader only uses malloc() for the units,
+// as nothing else it could call is safe outside of this thread.
+*/
+typedef struct unit_s unit_t;
+
+struct unit_s {
+    char   * text;          /* the unit's lines, each ended by '\n' */
+    size_t   len;
+    off_t    end;           /* offset in the dump after the unit */
+    unit_t * next;
+};
+
+/* how many units the reader may get ahead by */
+#define UNITS_QUEUED 256
+
+static struct {
+    FILE     * fp;
+    unit_t   * unit;        /* the unit lines are being taken from */
+    char     * next;        /* its next line */
+    off_t      offset;      /* offset in the dump after it */
+#ifdef USE_READER_THREAD
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    unit_t        * first;
+    unit_t        * last;
+    Int             queued;
+    bool            done;   /* the reader has queued the last unit */
+    bool            stop;   /* the reader should stop early */
+#endif
+} reader;
+
+static void free_unit(unit_t * unit) {
+    free(unit->text);
+    free(unit);
+}
+
+/* Read the next unit of the dump, or return NULL at its end. */
+static unit_t * read_unit(FILE * fp) {
+    unit_t * unit;
+    size_t   size = BIGBUF,
+             start,
+             len;
+    bool     body = false;
+    char   * line;
+
+    unit = malloc(sizeof(unit_t));
+    if (unit)
+        unit->text = malloc(size);
+    if (!unit || !unit->text)
+        panic("read_unit(): out of memory.");
+    unit->len = 0;
+    unit->next = NULL;
+
+    for (;;) {
+        start = unit->len;
+        do {
+            if (size - unit->len < BUF) {
+                size *= 2;
+                unit->text = realloc(unit->text, size);
+                if (!unit->text)
+                    panic("read_unit(): out of memory.");
+            }
+            if (!fgets(unit->text + unit->len, size - unit->len, fp))
+                break;
+            unit->len += strlen(unit->text + unit->len);
+        } while (unit->text[unit->len - 1] != '\n');
+
+        /* the end of the dump */
+        if (unit->len == start)
+            break;
+
+        if (unit->text[unit->len - 1] != '\n')
+            unit->text[unit->len++] = '\n';
+
+        line = unit->text + start;
+        len = unit->len - start - 1;
+
+        /* the same test as get_method() uses for the end of a body */
+        if (body) {
+            if (len == 2 && line[0] == '}' && line[1] == ';')
+                break;
+            continue;
+        }
+
+        while (len && isspace(line[len - 1]))
+            len--;
+
+        /* blank lines and those continued on the next stay with it */
+        if (!len || line[len - 1] == '\\')
+            continue;
+
+        if (line[len - 1] != '{')
+            break;
+        body = true;
+    }
+
+    if (!unit->len) {
+        free_unit(unit);
+        return NULL;
+    }
+
+    unit->end = ftello(fp);
+
+    return unit;
+}
+
+#ifdef USE_READER_THREAD
+static void * reader_thread(void * arg) {
+    unit_t * unit;
+
+    for (;;) {
+        unit = read_unit(reader.fp);
+
+        pthread_mutex_lock(&reader.lock);
+        while (reader.queued >= UNITS_QUEUED && !reader.stop)
+            pthread_cond_wait(&reader.cond, &reader.lock);
+
+        if (!unit || reader.stop) {
+            reader.done = true;
+            pthread_cond_signal(&reader.cond);
+            pthread_mutex_unlock(&reader.lock);
+            if (unit)
+                free_unit(unit);
+            return NULL;
+        }
+
+        if (reader.last)
+            reader.last->next = unit;
+        else
+            reader.first = unit;
+        reader.last = unit;
+        reader.queued++;
+        pthread_cond_signal(&reader.cond);
+        pthread_mutex_unlock(&reader.lock);
+    }
+}
+#endif
+
+static void start_reader(FILE * fp) {
+    reader.fp = fp;
+    reader.unit = NULL;
+    reader.offset = 0;
+#ifdef USE_READER_THREAD
+    reader.first = reader.last = NULL;
+    reader.queued = 0;
+    reader.done = reader.stop = false;
+    pthread_mutex_init(&reader.lock, NULL);
+    pthread_cond_init(&reader.cond, NULL);
+    if (pthread_create(&reader.thread, NULL, reader_thread, NULL))
+        panic("Unable to start the text dump reader.");
+#endif
+}
+
+static void stop_reader(void) {
+#ifdef USE_READER_THREAD
+    unit_t * unit;
+
+    pthread_mutex_lock(&reader.lock);
+    reader.stop = true;
+    pthread_cond_signal(&reader.cond);
+    pthread_mutex_unlock(&reader.lock);
+    pthread_join(reader.thread, NULL);
+
+    while ((unit = reader.first) != NULL) {
+        reader.first = unit->next;
+        free_unit(unit);
+    }
+    pthread_cond_destroy(&reader.cond);
+    pthread_mutex_destroy(&reader.lock);
+#endif
+
+    if (reader.unit) {
+        free_unit(reader.unit);
+        reader.unit = NULL;
+    }
+}
+
+static unit_t * next_unit(void) {
+#ifdef USE_READER_THREAD
+    unit_t * unit;
+
+    pthread_mutex_lock(&reader.lock);
+    while (!reader.first && !reader.done)
+        pthread_cond_wait(&reader.cond, &reader.lock);
+
+    unit = reader.first;
+    if (unit) {
+        reader.first = unit->next;
+        if (!reader.first)
+            reader.last = NULL;
+        reader.queued--;
+        pthread_cond_signal(&reader.cond);
+    }
+    pthread_mutex_unlock(&reader.lock);
+
+    return unit;
+#else
+    return read_unit(reader.fp);
+#endif
+}
+
+/* The next line of the dump, as fgetstring() would have read it. */
+static cStr * dump_line(void) {
+    cStr * line;
+    char * end;
+    Int    len;
+
+    if (!reader.unit || reader.next == reader.unit->text + reader.unit->len) {
+        if (reader.unit)
+            free_unit(reader.unit);
+        reader.unit = next_unit();
+        if (!reader.unit)
+            return NULL;
+        reader.next = reader.unit->text;
+        reader.offset = reader.unit->end;
+    }
+
+    end = memchr(reader.next, '\n',
+                 reader.unit->text + reader.unit->len - reader.next);
+    len = end - reader.next;
+#ifdef __Win32__
+    /* DOS and Windows text files may use \r\n or \n as a line termination */
+    if (len && reader.next[len - 1] == '\r')
+        len--;
+#endif
+    line = string_from_chars(reader.next, len);
+    reader.next = end + 1;
+
+    return line;
+}
+
+static Method * get_method(Obj * obj, Ident name, Method * old) {
     Method * method;
     cStr   * line;
 #ifndef ONLY_PARSE_TEXTDB
     cList  * code;
-    cList  * errors;
     cData    d;
-    Int      i;
 
     code = list_new(0);
     d.type = STRING;
@@ -1262,21 +1610,15 @@ static Method * get_method(FILE * fp, Obj * obj, const char * name) {
 
     /* used in printing method errs */
     method_start = line_count;
-    for (line = fgetstring(fp); line && running; line = fgetstring(fp)) {
+    for (line = dump_line(); line && running; line = dump_line()) {
         line_count++;
 
         /* hack for determining the end of a method */
         if (line->len == 2 && line->s[0] == '}' && line->s[1] == ';') {
             string_discard(line);
 #ifndef ONLY_PARSE_TEXTDB
-            method = compile(obj, code, &errors);
+            method = compile_method(obj, name, code, old);
             list_discard(code);
-
-            /* do warnings and errors, if they exist */
-            for (i = 0; i < errors->len; i++)
-                frob_n_print_errstr(errors->el[i].u.str->s, name, obj->objnum);
-
-            list_discard(errors);
 #endif
 
             /* return the method, null or not */
@@ -1319,8 +1661,8 @@ void compile_cdc_file(FILE * fp) {
     dump_hash = hash_new(0);
 #endif
 
-    /* use fgetstring because it'll expand until we have the whole line */
-    while ((line = fgetstring(fp)) && running) {
+    start_reader(fp);
+    while ((line = dump_line()) && running) {
         line_count++;
 
         /* Strip trailing spaces from the line. */
@@ -1452,7 +1794,7 @@ void compile_cdc_file(FILE * fp) {
                         if (cur_obj != NULL)
                             cache_discard(cur_obj);
                         if (print_objs)
-                            blank_and_print_obj("Compiling ", (100.0 * ftello(fp)) / filesize, obj);
+                            blank_and_print_obj("Compiling ", (100.0 * reader.offset) / filesize, obj);
                         cur_obj = obj;
                     }
                     handled = true;
@@ -1481,7 +1823,7 @@ void compile_cdc_file(FILE * fp) {
                 if (MATCH(s, "method", 6)) {
                     s += 6;
                     NEXT_WORD(s);
-                    handle_methcmd(fp, s, new, access);
+                    handle_methcmd(s, new, access);
                 }
                 handled = true;
                 break;
@@ -1490,7 +1832,7 @@ void compile_cdc_file(FILE * fp) {
                 if (MATCH(s, "eval", 4)) {
                     s += 4;
                     NEXT_WORD(s);
-                    handle_evalcmd(fp, s, new, access);
+                    handle_evalcmd(s, new, access);
                 }
                 handled = true;
                 break;
@@ -1499,7 +1841,7 @@ void compile_cdc_file(FILE * fp) {
                 if (MATCH(s, "bind_native", 11)) {
                     s += 11;
                     NEXT_WORD(s);
-                    handle_bind_nativecmd(fp, s);
+                    handle_bind_nativecmd(s);
                 }
                 handled = true;
                 break;
@@ -1527,9 +1869,11 @@ void compile_cdc_file(FILE * fp) {
         string_discard(str);
         str = NULL;
     }
+    stop_reader();
 
 #ifndef ONLY_PARSE_TEXTDB
     cache_discard(cur_obj);
+    object_free_methods(&replaced);
     verify_native_methods();
 #endif
 
@@ -1660,6 +2004,7 @@ static inline void dump_object_methods(Obj *obj, FILE *fp) {
             meth = obj->methods->tab[i].m;
             if (!meth)
                 continue;
+            unpack_method_body(meth);
 
             /* define it */
             fputs(method_definition(meth), fp);
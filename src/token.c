@@ -231,12 +231,11 @@ Int yylex(void)
 
     /* Check if it's a number. */
     if (isdigit(*s)) {
-        float_buf = string_new(32);
+        word = s;
 
         /* Convert the string to a number. */
         yylval.num = 0;
         while (len && isdigit(*s)) {
-            float_buf = string_addc(float_buf, *s);
             yylval.num = yylval.num * 10 + (*s - '0');
             s++, cur_pos++, len--;
         }
@@ -244,6 +243,8 @@ Int yylex(void)
         if ((*s == '.' && isdigit(*(s+1))) || *s == 'e') {
             Float f=yylval.num;
 
+            /* Only the digits so far, as atof() would take the rest too. */
+            float_buf = string_from_chars(word, s - word);
             f = atof(string_chars(float_buf));
             string_discard(float_buf);
 
@@ -282,7 +283,6 @@ Int yylex(void)
             yylval.fnum=f;
             return FLOAT;
         } else {
-            string_discard(float_buf);
             return INTEGER;
         }
     }
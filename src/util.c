@@ -78,25 +78,72 @@ uLong hash_string(cStr * str) {
     return hashval;
 }
 
-uLong hash_string_nocase(cStr * str) {
-    uLong hashval = 0, g;
-    int len;
-    char * s;
+/*
+// A hash of the contents of data, for data_hash(), read eight bytes at a
+// time.  With nocase, ASCII letters are folded to lower case a word at a
+// time: adding to the low seven bits of each byte sets its top bit when the
+// byte is past a bound, without carrying into the next byte, and the
+// bytes which are past 'A' but not past 'Z' get 0x20 added.
+*/
+#define HASH_C1   UINT64_C(0x87c37b91114253d5)
+#define HASH_C2   UINT64_C(0x4cf5ad432745937f)
+#define HASH_ONES UINT64_C(0x0101010101010101)
 
-    s = string_chars(str);
-    len = string_length(str);
+static inline uint64_t hash_fold_case(uint64_t w) {
+    uint64_t low = w & (0x7f * HASH_ONES),
+             past_z = low + (0x7f - 'Z') * HASH_ONES,
+             from_a = low + (0x80 - 'A') * HASH_ONES;
 
-    /* Algorithm by Peter J. Weinberger. */
-    for (; len; len--, s++) {
-        hashval = (hashval << 4) + (*s & 0x5f);
-        g = hashval & 0xf0000000;
-        if (g) {
-            hashval ^= g >> 24;
-            hashval ^= g;
+    return w | ((from_a & ~past_z & ~w & (0x80 * HASH_ONES)) >> 2);
+}
+
+static inline uint64_t hash_word(uint64_t h, uint64_t w) {
+    w *= HASH_C1;
+    w = (w << 31) | (w >> 33);
+    w *= HASH_C2;
+    h ^= w;
+    h = (h << 27) | (h >> 37);
+    return h * 5 + 0x52dce729;
+}
+
+static inline uLong hash_finish(uint64_t h) {
+    h ^= h >> 33;
+    h *= UINT64_C(0xff51afd7ed558ccd);
+    h ^= h >> 33;
+    h *= UINT64_C(0xc4ceb9fe1a85ec53);
+    h ^= h >> 33;
+    return (uLong) h;
+}
+
+uLong hash_chars(const char *s, Int len, bool nocase) {
+    uint64_t h1 = len, h2 = ~(uint64_t) len, w1, w2;
+
+    /* Two words at a time, into separate hashes, so that neither waits on
+     * the multiplies of the other. */
+    for (; len >= 16; len -= 16, s += 16) {
+        memcpy(&w1, s, 8);
+        memcpy(&w2, s + 8, 8);
+        if (nocase) {
+            w1 = hash_fold_case(w1);
+            w2 = hash_fold_case(w2);
         }
+        h1 = hash_word(h1, w1);
+        h2 = hash_word(h2, w2);
+    }
+    for (; len > 0; len -= 8, s += 8) {
+        w1 = 0;
+        memcpy(&w1, s, len < 8 ? len : 8);
+        if (nocase)
+            w1 = hash_fold_case(w1);
+        h1 = hash_word(h1, w1);
     }
 
-    return hashval;
+    return hash_finish(h1 ^ hash_word(h2, h1));
+}
+
+/* Add value to a hash of a sequence of values. */
+uLong hash_combine(uLong hash, uLong value) {
+    return hash_finish(hash_word(hash, value));
 }
 
 
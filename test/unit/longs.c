@@ -0,0 +1,145 @@
+/*
+// Full copyright information is available in the file ../doc/CREDITS
+//
+// Check that read_longs() decodes every width of number that write_long()
+// writes exactly as read_long() does, and leaves the position in the same
+// place.
+*/
+
+#include "defs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cdc_db.h"
+
+#define LONG_BITS  ((Int) sizeof(Long) * 8)
+#define RUNS       2000
+#define MAX_RUN    300
+
+static Int failures;
+
+/* genesis and coldcc each define this; nothing here looks names up. */
+cObjnum get_object_name(Ident id) {
+    return INV_OBJNUM;
+}
+
+/* A small xorshift generator, so that a failure can be run again. */
+static uint64_t rand_state = 88172645463325252ULL;
+
+static uint64_t next_rand(void)
+{
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 7;
+    rand_state ^= rand_state << 17;
+    return rand_state;
+}
+
+/* A number whose magnitude takes up to bits bits, of either sign. */
+static Long rand_long(Int bits)
+{
+    uLong n = (uLong) next_rand();
+
+    if (bits < LONG_BITS)
+        n &= ((uLong) 1 << bits) - 1;
+    if (next_rand() & 1)
+        n ^= (uLong)(-1);
+    return (Long) n;
+}
+
+/* Write values, then read them back with read_long() one at a time and
+ * with read_longs() in runs of random length. */
+static void check(const Long *values, Int count, const char *what)
+{
+    cBuf *buf = buffer_new(0);
+    Long  one_pos = 0,
+          run_pos = 0,
+          n,
+        * dest;
+    Int   i, j, run;
+
+    for (i = 0; i < count; i++)
+        buf = write_long(buf, values[i]);
+
+    dest = (Long *) malloc(sizeof(Long) * (count + 1));
+
+    for (i = 0; i < count; i += run) {
+        run = 1 + (Int) (next_rand() % MAX_RUN);
+        if (run > count - i)
+            run = count - i;
+        read_longs(buf, &run_pos, dest, run);
+        for (j = 0; j < run; j++) {
+            n = read_long(buf, &one_pos);
+            if (n != values[i + j] || dest[j] != n) {
+                fprintf(stderr, "%s: value %lld read as %lld by read_long()"
+                        " and %lld by read_longs()\n", what,
+                        (long long) values[i + j], (long long) n,
+                        (long long) dest[j]);
+                failures++;
+            }
+        }
+        if (run_pos != one_pos) {
+            fprintf(stderr, "%s: read_longs() stopped at %lld, read_long() "
+                    "at %lld\n", what, (long long) run_pos,
+                    (long long) one_pos);
+            failures++;
+            run_pos = one_pos;
+        }
+    }
+
+    if (one_pos != buf->len) {
+        fprintf(stderr, "%s: read %lld of %lld bytes\n", what,
+                (long long) one_pos, (long long) buf->len);
+        failures++;
+    }
+
+    free(dest);
+    buffer_discard(buf);
+}
+
+/* Zero, and the numbers on either side of each power of two, of both
+ * signs, so that each width and each switch in the encoding is crossed. */
+static void check_boundaries(void)
+{
+    Long values[LONG_BITS * 6 + 1];
+    uLong p;
+    Int   b, count = 0;
+
+    values[count++] = 0;
+    for (b = 0; b < LONG_BITS; b++) {
+        p = (uLong) 1 << b;
+        values[count++] = (Long) (p - 1);
+        values[count++] = (Long) p;
+        values[count++] = (Long) (p + 1);
+        values[count++] = (Long) ~(p - 1);
+        values[count++] = (Long) ~p;
+        values[count++] = (Long) ~(p + 1);
+    }
+
+    check(values, count, "boundaries");
+}
+
+/* Runs of random numbers, each run mixing every width. */
+static void check_random(void)
+{
+    Long values[MAX_RUN * 4];
+    Int  i, r, count;
+
+    for (r = 0; r < RUNS; r++) {
+        count = 1 + (Int) (next_rand() % (MAX_RUN * 4));
+        for (i = 0; i < count; i++)
+            values[i] = rand_long((Int) (next_rand() % (LONG_BITS + 1)));
+        check(values, count, "random");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    check_boundaries();
+    check_random();
+
+    if (failures) {
+        fprintf(stderr, "%ld failures\n", (long) failures);
+        return 1;
+    }
+    return 0;
+}